@@ -1,9 +1,49 @@
 #pragma once
 #include <thread>
 #include "ThreadSafeQue.hpp"
+#include "RingBufferQue.hpp"
+#include "SpscQue.hpp"
+#include "BoundedQue.hpp"
+#include "PriorityQue.hpp"
+#include "TimerWheel.hpp"
+#include "WorkStealingPool.hpp"
+#include "ActorStats.hpp"
+#include "ReplySlot.hpp"
+#include "CpuAffinity.hpp"
+#include "AsyncLog.hpp"
 #include <atomic>
+#include <chrono>
 #include <iostream>
-template <typename ClassType, typename QueType> class ActorSingle {
+#include <utility>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+// MailBox selects the queue behind PostMsg: the default two-lock
+// ThreadSafeQue is unbounded, RingBufferQue is bounded and lock-free, and
+// SpscQue is a wait-free ring for actors with a single producer.
+// BoundedQue caps the mailbox and applies an OverflowPolicy (block, fail
+// fast, drop oldest or conflate by key) once it is full. PriorityQue adds
+// urgent lanes that PostMsgLane can jump ahead of queued bulk traffic.
+//
+// PostMsgAfter delivers a message later through the shared TimerService
+// wheel; pending timers are cancelled when the actor stops.
+//
+// A derived class starts its worker from its constructor, either on a
+// dedicated thread (StartThread) or as a mailbox task on a shared
+// WorkStealingPool (StartOnExecutor), and calls StopWorker from its
+// destructor. Either way DealMsg is never run concurrently for one actor.
+// StartThread can pin the dedicated thread to a CpuSet; ShardGroup runs
+// several pinned instances of one actor class behind key-based routing.
+//
+// Building with ACTOR_STATS stamps every message on PostMsg and exposes
+// per-actor depth, latency and throughput through Stats().
+// ACTOR_TRACE additionally carries a trace context from handler to the
+// messages it posts and records every hop for ActorTracer's Chrome-trace
+// export.
+template <typename ClassType, typename QueType,
+    template <typename> class MailBox = ThreadSafeQue>
+class ActorSingle {
 public:
     static ClassType &Inst() {
         static ClassType as;
@@ -12,16 +52,365 @@ public:
 
     ~ActorSingle() {}
 
-    void PostMsg( const QueType &data ) { _que.push( data ); }
+    void PostMsg( const QueType &data ) { EmplaceMsg( data ); }
+
+    void PostMsg( QueType &&data ) { EmplaceMsg( std::move( data ) ); }
+
+    // Constructs the message directly in the mailbox slot. A full
+    // RingBufferQue or SpscQue mailbox makes this yield until the worker
+    // frees a slot, so an actor posting to itself while its mailbox is full
+    // livelocks; use TryEmplaceMsg from the actor's own handlers.
+    template <typename... Args> void EmplaceMsg( Args &&...args ) {
+#ifdef ACTOR_STATS
+        _stats.OnPost( 1 );
+        std::size_t grew = Enqueue( ActorStats::Now(), std::forward<Args>( args )... );
+        if ( grew == 0 ) {
+            _stats.OnDropped( 1 );
+        }
+#else
+        std::size_t grew = Enqueue( std::forward<Args>( args )... );
+#endif
+        Schedule( grew );
+    }
+
+    // Never blocks: returns false if a bounded mailbox is full (or, under
+    // OverflowPolicy::Conflate, merged the message into a queued one).
+    bool TryPostMsg( const QueType &data ) { return TryEmplaceMsg( data ); }
+
+    bool TryPostMsg( QueType &&data ) { return TryEmplaceMsg( std::move( data ) ); }
+
+    template <typename... Args> bool TryEmplaceMsg( Args &&...args ) {
+#ifdef ACTOR_STATS
+        _stats.OnPost( 1 );
+        bool added = _que.TryEmplace( ActorStats::Now(), std::forward<Args>( args )... );
+        if ( !added ) {
+            _stats.OnDropped( 1 );
+        }
+#else
+        bool added = _que.TryEmplace( std::forward<Args>( args )... );
+#endif
+        Schedule( added ? 1 : 0 );
+        return added;
+    }
+
+    // PriorityQue mailboxes only; lane 0 is the most urgent.
+    void PostMsgLane( std::size_t lane, const QueType &data ) {
+        EmplaceMsgLane( lane, data );
+    }
+
+    void PostMsgLane( std::size_t lane, QueType &&data ) {
+        EmplaceMsgLane( lane, std::move( data ) );
+    }
+
+    template <typename... Args> void EmplaceMsgLane( std::size_t lane, Args &&...args ) {
+#ifdef ACTOR_STATS
+        _stats.OnPost( 1 );
+        _que.EmplaceLane( lane, ActorStats::Now(), std::forward<Args>( args )... );
+#else
+        _que.EmplaceLane( lane, std::forward<Args>( args )... );
+#endif
+        Schedule( 1 );
+    }
+
+    // Posts data once delay has passed, rounded up to the timer tick.
+    template <typename Rep, typename Period>
+    TimerId PostMsgAfter( std::chrono::duration<Rep, Period> delay, QueType data ) {
+        _timed.store( true, std::memory_order_relaxed );
+        return TimerService::Default().Schedule(
+            std::chrono::duration_cast<TimerService::Clock::duration>( delay ),
+            [this, data = std::move( data )]() mutable { PostMsg( std::move( data ) ); },
+            this );
+    }
+
+    // False if the message was already posted or the timer cancelled.
+    bool CancelTimer( TimerId id ) { return TimerService::Default().Cancel( id ); }
+
+    // Request/response: msg carries a Reply<R> member named reply, which the
+    // handler answers with msg.reply.Set( ... ). Works with variant
+    // mailboxes when Msg is one of the alternatives. The reply slot comes
+    // from a pool, so there is no promise/future allocation per call.
+    template <typename Msg> auto Ask( Msg msg ) {
+        using R = typename decltype( msg.reply )::value_type;
+        ReplyFuture<R> future = ReplyPool<R>::Default().Bind( msg.reply );
+        EmplaceMsg( std::move( msg ) );
+        return future;
+    }
+
+    template <typename Range> void PostMsgBulk( Range &&range ) {
+#ifdef ACTOR_STATS
+        std::vector<Letter> letters;
+        std::uint64_t now = ActorStats::Now();
+        for ( auto &&elm : range ) {
+            if constexpr ( std::is_lvalue_reference_v<Range> ) {
+                letters.emplace_back( now, elm );
+            } else {
+                letters.emplace_back( now, std::move( elm ) );
+            }
+        }
+        std::size_t count = letters.size();
+        _stats.OnPost( count );
+        std::size_t grew = _que.PushBulk( std::move( letters ) );
+        _stats.OnDropped( count - grew );
+        Schedule( grew );
+#else
+        Schedule( _que.PushBulk( std::forward<Range>( range ) ) );
+#endif
+    }
+
+#ifdef ACTOR_STATS
+    ActorStatsSnapshot Stats() { return _stats.Snapshot(); }
+#endif
 
 protected:
-    ActorSingle() : _bstop( false ) {}
+#ifdef ACTOR_STATS
+    using Letter = StampedMsg<QueType>;
+
+    ActorSingle( const char *name = "actor" )
+        : _bstop( false ), _name( name ), _stats( name ) {
+        // Outlive every actor, whose StopWorker cancels its timers and
+        // whose worker logs on exit.
+        TimerService::Default();
+        AsyncLogger::Inst();
+    }
+#else
+    using Letter = QueType;
+
+    ActorSingle( const char *name = "actor" ) : _bstop( false ), _name( name ) {
+        // Outlive every actor, whose StopWorker cancels its timers and
+        // whose worker logs on exit.
+        TimerService::Default();
+        AsyncLogger::Inst();
+    }
+#endif
 
     ActorSingle( const ActorSingle & )            = delete;
     ActorSingle( ActorSingle && )                 = delete;
     ActorSingle &operator=( const ActorSingle & ) = delete;
 
+    // Upper bound on messages a worker drains per wakeup.
+    static constexpr std::size_t max_batch = 64;
+
+    // Call before starting the worker; see WaitPolicy.
+    void SetWaitPolicy( const WaitPolicy &policy ) { _que.SetWaitPolicy( policy ); }
+
+    // BoundedQue mailboxes only; like SetWaitPolicy these must be called
+    // before the worker starts. A Block policy deadlocks if the actor posts
+    // to itself while its mailbox is full.
+    void SetMailboxCapacity( std::size_t capacity, OverflowPolicy policy ) {
+        _que.SetCapacity( capacity, policy );
+    }
+
+    // key maps a message to its conflation key for OverflowPolicy::Conflate.
+    template <typename KeyFunc> void SetConflateKey( KeyFunc key ) {
+        _que.SetConflateKey( [key]( const Letter &letter ) -> std::size_t {
+#ifdef ACTOR_STATS
+            return key( letter.msg );
+#else
+            return key( letter );
+#endif
+        } );
+    }
+
+    // callback( depth, above ) runs on the posting or draining thread when
+    // the depth reaches high and again when it falls back to low.
+    template <typename Callback>
+    void SetDepthWatermarks( std::size_t high, std::size_t low, Callback callback ) {
+        _que.SetDepthWatermarks( high, low, std::move( callback ) );
+    }
+
+    // With a non-empty affinity the worker pins itself before it allocates
+    // anything, so its batch buffer is first touched on that CPU's node.
+    void StartThread( CpuSet affinity = {} ) {
+        _thread = std::thread( [this, affinity = std::move( affinity )]() {
+            if ( !affinity.empty() ) {
+                PinCurrentThread( affinity );
+            }
+            std::vector<Letter> batch;
+            for ( ; ( _bstop.load() == false ); ) {
+                batch.clear();
+                if ( _que.WaitAndDrain( batch, max_batch ) == 0 ) {
+                    continue;
+                }
+
+                for ( auto &letter : batch ) {
+                    Deliver( letter );
+                }
+            }
+
+            LogInfo( _name, " thread exit " );
+        } );
+    }
+
+    void StartOnExecutor( WorkStealingPool &pool = WorkStealingPool::Default() ) {
+        _pool = &pool;
+    }
+
+    // Joins the dedicated thread, or waits for an in-flight executor task;
+    // messages still queued at that point are dropped.
+    void StopWorker() {
+        if ( _timed.load( std::memory_order_relaxed ) ) {
+            TimerService::Default().CancelOwner( this );
+        }
+        _bstop = true;
+        _que.NotifyStop();
+        if ( _thread.joinable() ) {
+            _thread.join();
+        }
+        while ( _tasks.load() != 0 ) {
+            std::this_thread::yield();
+        }
+    }
+
     std::atomic<bool> _bstop;
-    ThreadSafeQue<QueType> _que;
+    MailBox<Letter> _que;
     std::thread _thread;
+
+private:
+    // Returns how far the mailbox depth grew; only BoundedQue reports less
+    // than one when it rejects, evicts or conflates.
+    template <typename... Args> std::size_t Enqueue( Args &&...args ) {
+        using result = decltype( _que.emplace( std::forward<Args>( args )... ) );
+        if constexpr ( std::is_void_v<result> ) {
+            _que.emplace( std::forward<Args>( args )... );
+            return 1;
+        } else {
+            return _que.emplace( std::forward<Args>( args )... );
+        }
+    }
+
+    // Executor mode: _scheduled is set while a mailbox task is queued or
+    // running, which is what keeps DealMsg serial across pool threads. The
+    // fence pairs with the one in RunBatch: either this post sees the flag
+    // cleared, or the batch's empty() check sees the message just queued.
+    void Schedule( std::size_t count ) {
+        if ( !_pool || count == 0 ) {
+            return;
+        }
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        if ( !_scheduled.load( std::memory_order_relaxed ) && !_scheduled.exchange( true ) ) {
+            SubmitBatch();
+        }
+    }
+
+    void SubmitBatch() {
+        _tasks.fetch_add( 1 );
+        _pool->Submit( [this]() { RunBatch(); } );
+    }
+
+    template <typename Msg, typename = void>
+    struct deals_by_value : std::false_type {};
+    template <typename Msg>
+    struct deals_by_value<Msg, std::void_t<decltype( std::declval<ClassType &>().DealMsg(
+                                   std::declval<Msg &&>() ) )>> : std::true_type {};
+
+    template <typename Msg, typename = void>
+    struct deals_by_ref : std::false_type {};
+    template <typename Msg>
+    struct deals_by_ref<Msg, std::void_t<decltype( std::declval<ClassType &>().DealMsg(
+                                 std::declval<Msg &>() ) )>> : std::true_type {};
+
+    template <typename Msg> struct is_variant : std::false_type {};
+    template <typename... Msgs>
+    struct is_variant<std::variant<Msgs...>> : std::true_type {};
+
+    // DealMsg may take the message by value or rvalue reference (it is
+    // moved in), by lvalue reference, or as the older
+    // std::shared_ptr<QueType>, which costs an allocation per message.
+    // A std::variant mailbox without a DealMsg for the variant itself is
+    // unpacked to the DealMsg overload of the held alternative.
+    void Dispatch( QueType &msg ) {
+        ClassType &self = *static_cast<ClassType *>( this );
+        if constexpr ( deals_by_value<QueType>::value ) {
+            self.DealMsg( std::move( msg ) );
+        } else if constexpr ( deals_by_ref<QueType>::value ) {
+            self.DealMsg( msg );
+        } else if constexpr ( is_variant<QueType>::value ) {
+            DispatchVariant( self, msg,
+                std::make_index_sequence<std::variant_size_v<QueType>>() );
+        } else {
+            self.DealMsg( std::make_shared<QueType>( std::move( msg ) ) );
+        }
+    }
+
+    template <std::size_t I> static void DispatchAlternative( ClassType &self, QueType &msg ) {
+        using Alt = std::variant_alternative_t<I, QueType>;
+        Alt &alt  = *std::get_if<I>( &msg );
+        if constexpr ( deals_by_value<Alt>::value ) {
+            self.DealMsg( std::move( alt ) );
+        } else if constexpr ( deals_by_ref<Alt>::value ) {
+            self.DealMsg( alt );
+        } else {
+            static_assert( sizeof( Alt ) == 0, "no DealMsg overload for a message type" );
+        }
+    }
+
+    // Jump table built at compile time, one entry per alternative.
+    template <std::size_t... I>
+    static void DispatchVariant( ClassType &self, QueType &msg, std::index_sequence<I...> ) {
+        using Handler = void ( * )( ClassType &, QueType & );
+        static constexpr Handler table[] = { &DispatchAlternative<I>... };
+        if ( !msg.valueless_by_exception() ) {
+            table[msg.index()]( self, msg );
+        }
+    }
+
+    void Deliver( Letter &letter ) {
+#ifdef ACTOR_STATS
+        std::uint64_t start = ActorStats::Now();
+        _stats.OnDequeue( start - letter.enqueue_ns );
+#ifdef ACTOR_TRACE
+        ActorTracer::Enter( letter.trace );
+#endif
+        Dispatch( letter.msg );
+        std::uint64_t finish = ActorStats::Now();
+        _stats.OnHandled( finish - start );
+#ifdef ACTOR_TRACE
+        ActorTracer::Leave( _name, letter.trace, letter.enqueue_ns, start, finish );
+#endif
+#else
+        Dispatch( letter );
+#endif
+    }
+
+    // Once stopped the flag stays set, so no further task is submitted.
+    void RunBatch() {
+        if ( !_bstop.load() ) {
+            _batch.clear();
+            _que.DrainTo( _batch, max_batch );
+            for ( auto &letter : _batch ) {
+                Deliver( letter );
+            }
+            _scheduled.store( false );
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            if ( !_que.empty() && !_scheduled.exchange( true ) ) {
+                SubmitBatch();
+            }
+        }
+        _tasks.fetch_sub( 1 );
+    }
+
+    const char *_name;
+    WorkStealingPool *_pool = nullptr;
+    std::atomic<bool> _scheduled{ false };
+    // Submitted mailbox tasks that have not returned yet.
+    std::atomic<std::size_t> _tasks{ 0 };
+    std::atomic<bool> _timed{ false };
+    std::vector<Letter> _batch;
+#ifdef ACTOR_STATS
+    ActorStats _stats;
+#endif
 };
+
+// Actor serving several message types from one mailbox. Messages are
+// stored inline as std::variant<Msgs...> (no per-message allocation or
+// virtual base) and each is handed to the DealMsg overload for its type:
+//
+//   class Hub : public ActorVariant<Hub, Ping, Stop> {
+//       friend ActorVariant<Hub, Ping, Stop>;
+//       void DealMsg( const Ping & );
+//       void DealMsg( Stop );
+//   };
+//
+// For another mailbox use ActorSingle with std::variant<Msgs...> directly.
+template <typename ClassType, typename... Msgs>
+using ActorVariant = ActorSingle<ClassType, std::variant<Msgs...>>;
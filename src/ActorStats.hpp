@@ -0,0 +1,273 @@
+#pragma once
+
+// Per-actor mailbox counters. Everything in here only exists when the
+// build defines ACTOR_STATS; without it ActorSingle carries no extra state
+// and does no extra work per message. ACTOR_TRACE implies ACTOR_STATS.
+#if defined( ACTOR_TRACE ) && !defined( ACTOR_STATS )
+#define ACTOR_STATS
+#endif
+
+#ifdef ACTOR_STATS
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <sstream>
+#include <ostream>
+#include <algorithm>
+#include <utility>
+
+#include "QueSlot.hpp"
+#include "ActorTrace.hpp"
+
+// Message wrapper used as the mailbox element while stats are enabled.
+template <typename T> struct StampedMsg {
+    template <typename... Args>
+    explicit StampedMsg( std::uint64_t stamp, Args &&...args )
+        : msg( make_msg<T>( std::forward<Args>( args )... ) ),
+          enqueue_ns( stamp ) {}
+
+    T msg;
+    std::uint64_t enqueue_ns;
+#ifdef ACTOR_TRACE
+    // Captured on the posting thread.
+    TraceContext trace = ActorTracer::OnPost();
+#endif
+};
+
+// Power-of-two buckets over nanoseconds; bucket i holds [2^(i-1), 2^i).
+class LatencyHistogram {
+public:
+    static constexpr std::size_t bucket_count = 64;
+
+    void Record( std::uint64_t ns ) {
+        std::size_t bucket = 0;
+        while ( ns != 0 && bucket + 1 < bucket_count ) {
+            ns >>= 1;
+            ++bucket;
+        }
+        buckets[bucket].fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    std::array<std::uint64_t, bucket_count> Counts() const {
+        std::array<std::uint64_t, bucket_count> res{};
+        for ( std::size_t i = 0; i < bucket_count; ++i ) {
+            res[i] = buckets[i].load( std::memory_order_relaxed );
+        }
+        return res;
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, bucket_count> buckets{};
+};
+
+struct HistogramSnapshot {
+    std::array<std::uint64_t, LatencyHistogram::bucket_count> counts{};
+
+    std::uint64_t Total() const {
+        std::uint64_t total = 0;
+        for ( auto c : counts ) {
+            total += c;
+        }
+        return total;
+    }
+
+    // Upper bound in ns of the bucket holding quantile q (0..1).
+    std::uint64_t Percentile( double q ) const {
+        std::uint64_t total = Total();
+        if ( total == 0 ) {
+            return 0;
+        }
+        auto rank = static_cast<std::uint64_t>( q * ( total - 1 ) ) + 1;
+        std::uint64_t seen = 0;
+        for ( std::size_t i = 0; i < counts.size(); ++i ) {
+            seen += counts[i];
+            if ( seen >= rank ) {
+                return i == 0 ? 0 : ( std::uint64_t( 1 ) << i ) - 1;
+            }
+        }
+        return ~std::uint64_t( 0 );
+    }
+};
+
+struct ActorStatsSnapshot {
+    std::string name;
+    std::uint64_t depth;
+    std::uint64_t high_water;
+    std::uint64_t processed;
+    std::uint64_t dropped;
+    double msgs_per_sec;
+    HistogramSnapshot queue_latency;
+    HistogramSnapshot service_time;
+
+    std::string ToText() const {
+        std::ostringstream os;
+        os << name << ": depth=" << depth << " high_water=" << high_water
+           << " processed=" << processed << " dropped=" << dropped
+           << " msgs/s=" << msgs_per_sec
+           << " queue_ns(p50/p99/p999)=" << queue_latency.Percentile( 0.5 )
+           << "/" << queue_latency.Percentile( 0.99 ) << "/"
+           << queue_latency.Percentile( 0.999 )
+           << " service_ns(p50/p99/p999)=" << service_time.Percentile( 0.5 )
+           << "/" << service_time.Percentile( 0.99 ) << "/"
+           << service_time.Percentile( 0.999 );
+        return os.str();
+    }
+
+    std::string ToJson() const {
+        std::ostringstream os;
+        os << "{\"name\":\"" << name << "\",\"depth\":" << depth
+           << ",\"high_water\":" << high_water
+           << ",\"processed\":" << processed
+           << ",\"dropped\":" << dropped
+           << ",\"msgs_per_sec\":" << msgs_per_sec
+           << ",\"queue_latency_ns\":" << HistogramJson( queue_latency )
+           << ",\"service_time_ns\":" << HistogramJson( service_time ) << "}";
+        return os.str();
+    }
+
+private:
+    static std::string HistogramJson( const HistogramSnapshot &h ) {
+        std::ostringstream os;
+        os << "{\"count\":" << h.Total() << ",\"p50\":" << h.Percentile( 0.5 )
+           << ",\"p99\":" << h.Percentile( 0.99 )
+           << ",\"p999\":" << h.Percentile( 0.999 ) << ",\"buckets\":[";
+        for ( std::size_t i = 0; i < h.counts.size(); ++i ) {
+            os << ( i ? "," : "" ) << h.counts[i];
+        }
+        os << "]}";
+        return os.str();
+    }
+};
+
+class ActorStats {
+public:
+    static std::uint64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch() )
+            .count();
+    }
+
+    explicit ActorStats( const char *name )
+        : name_( name ), last_snapshot_ns( Now() ) {
+        std::lock_guard<std::mutex> lock( RegistryMutex() );
+        Registry().push_back( this );
+    }
+
+    ~ActorStats() {
+        std::lock_guard<std::mutex> lock( RegistryMutex() );
+        auto &registry = Registry();
+        registry.erase(
+            std::remove( registry.begin(), registry.end(), this ),
+            registry.end() );
+    }
+
+    ActorStats( const ActorStats & )            = delete;
+    ActorStats &operator=( const ActorStats & ) = delete;
+
+    void OnPost( std::size_t count ) {
+        std::uint64_t in = posted.fetch_add( count, std::memory_order_relaxed ) + count;
+        // Other threads' dequeues and drops may already be visible while
+        // their posts raced past ours, so the difference can dip below zero.
+        std::uint64_t out = dequeued.load( std::memory_order_relaxed ) +
+                            dropped.load( std::memory_order_relaxed );
+        if ( out >= in ) {
+            return;
+        }
+        std::uint64_t depth = in - out;
+        std::uint64_t high = high_water.load( std::memory_order_relaxed );
+        while ( depth > high &&
+                !high_water.compare_exchange_weak(
+                    high, depth, std::memory_order_relaxed ) ) {
+        }
+    }
+
+    // Messages a bounded mailbox rejected, evicted or conflated.
+    void OnDropped( std::size_t count ) {
+        dropped.fetch_add( count, std::memory_order_relaxed );
+    }
+
+    void OnDequeue( std::uint64_t queued_ns ) {
+        dequeued.fetch_add( 1, std::memory_order_relaxed );
+        queue_latency.Record( queued_ns );
+    }
+
+    void OnHandled( std::uint64_t service_ns ) {
+        service_time.Record( service_ns );
+    }
+
+    // msgs_per_sec covers the interval since the previous Snapshot call.
+    ActorStatsSnapshot Snapshot() {
+        ActorStatsSnapshot res;
+        std::uint64_t in  = posted.load( std::memory_order_relaxed );
+        std::uint64_t out = dequeued.load( std::memory_order_relaxed );
+        std::uint64_t lost = dropped.load( std::memory_order_relaxed );
+        res.name          = name_;
+        res.depth         = in > out + lost ? in - out - lost : 0;
+        res.high_water    = high_water.load( std::memory_order_relaxed );
+        res.processed     = out;
+        res.dropped       = lost;
+
+        std::uint64_t now     = Now();
+        std::uint64_t prev_ns = last_snapshot_ns.exchange( now );
+        std::uint64_t prev    = last_processed.exchange( out );
+        res.msgs_per_sec = now > prev_ns ? ( out - prev ) * 1e9 / ( now - prev_ns )
+                                         : 0.0;
+        res.queue_latency.counts = queue_latency.Counts();
+        res.service_time.counts  = service_time.Counts();
+        return res;
+    }
+
+    static std::vector<ActorStatsSnapshot> SnapshotAll() {
+        std::vector<ActorStatsSnapshot> res;
+        std::lock_guard<std::mutex> lock( RegistryMutex() );
+        for ( auto *stats : Registry() ) {
+            res.push_back( stats->Snapshot() );
+        }
+        return res;
+    }
+
+    static void DumpText( std::ostream &os ) {
+        for ( const auto &snapshot : SnapshotAll() ) {
+            os << snapshot.ToText() << "\n";
+        }
+    }
+
+    static void DumpJson( std::ostream &os ) {
+        os << "[";
+        bool first = true;
+        for ( const auto &snapshot : SnapshotAll() ) {
+            os << ( first ? "" : "," ) << snapshot.ToJson();
+            first = false;
+        }
+        os << "]\n";
+    }
+
+private:
+    static std::vector<ActorStats *> &Registry() {
+        static std::vector<ActorStats *> registry;
+        return registry;
+    }
+
+    static std::mutex &RegistryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    const char *name_;
+    std::atomic<std::uint64_t> posted{ 0 };
+    std::atomic<std::uint64_t> dequeued{ 0 };
+    std::atomic<std::uint64_t> dropped{ 0 };
+    std::atomic<std::uint64_t> high_water{ 0 };
+    std::atomic<std::uint64_t> last_snapshot_ns;
+    std::atomic<std::uint64_t> last_processed{ 0 };
+    LatencyHistogram queue_latency;
+    LatencyHistogram service_time;
+};
+
+#endif
@@ -0,0 +1,267 @@
+#pragma once
+
+// Causal tracing across actor hops. Only exists when the build defines
+// ACTOR_TRACE, which also turns on ACTOR_STATS: the trace context rides in
+// the same StampedMsg envelope as the enqueue time.
+//
+// A message posted from outside any handler starts a trace (subject to
+// sampling); messages posted from inside DealMsg inherit the trace of the
+// message being handled and name its span as their parent. Each handled
+// message records one hop (enqueue, dequeue and finish times) into a ring
+// owned by the handling thread. ExportChromeTrace writes the rings as
+// Chrome trace-event JSON, which chrome://tracing and ui.perfetto.dev load.
+#ifdef ACTOR_TRACE
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <algorithm>
+
+struct TraceContext {
+    std::uint64_t trace_id  = 0; // 0 when the message is not sampled
+    std::uint64_t span_id   = 0;
+    std::uint64_t parent_id = 0; // 0 for the root of a trace
+    std::uint32_t poster    = 0; // tracer thread id of the sender
+};
+
+struct TraceHop {
+    const char *actor;
+    TraceContext context;
+    std::uint32_t thread;
+    std::uint64_t enqueue_ns, dequeue_ns, finish_ns;
+};
+
+// Single-writer ring of hops. The owning thread overwrites the oldest
+// entry when full; readers copy entries under a per-slot sequence number
+// and skip the ones being rewritten, so neither side ever blocks.
+class TraceRing {
+public:
+    static constexpr std::size_t capacity = 1 << 14;
+
+    explicit TraceRing( std::uint32_t thread ) : thread( thread ), slots( new slot[capacity] ) {}
+
+    void Push( const char *actor, const TraceContext &ctx, std::uint64_t enqueue_ns,
+        std::uint64_t dequeue_ns, std::uint64_t finish_ns ) {
+        std::uint64_t h = head.load( std::memory_order_relaxed );
+        slot &s         = slots[h & ( capacity - 1 )];
+        s.seq.store( 2 * h + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+        s.actor.store( actor, std::memory_order_relaxed );
+        s.trace.store( ctx.trace_id, std::memory_order_relaxed );
+        s.span.store( ctx.span_id, std::memory_order_relaxed );
+        s.parent.store( ctx.parent_id, std::memory_order_relaxed );
+        s.poster.store( ctx.poster, std::memory_order_relaxed );
+        s.enqueue.store( enqueue_ns, std::memory_order_relaxed );
+        s.dequeue.store( dequeue_ns, std::memory_order_relaxed );
+        s.finish.store( finish_ns, std::memory_order_relaxed );
+        s.seq.store( 2 * h + 2, std::memory_order_release );
+        head.store( h + 1, std::memory_order_release );
+    }
+
+    void CopyTo( std::vector<TraceHop> &out ) const {
+        std::uint64_t end   = head.load( std::memory_order_acquire );
+        std::uint64_t begin = end > capacity ? end - capacity : 0;
+        for ( std::uint64_t i = begin; i < end; ++i ) {
+            const slot &s = slots[i & ( capacity - 1 )];
+            if ( s.seq.load( std::memory_order_acquire ) != 2 * i + 2 ) {
+                continue;
+            }
+            TraceHop hop;
+            hop.actor             = s.actor.load( std::memory_order_relaxed );
+            hop.context.trace_id  = s.trace.load( std::memory_order_relaxed );
+            hop.context.span_id   = s.span.load( std::memory_order_relaxed );
+            hop.context.parent_id = s.parent.load( std::memory_order_relaxed );
+            hop.context.poster    = s.poster.load( std::memory_order_relaxed );
+            hop.enqueue_ns        = s.enqueue.load( std::memory_order_relaxed );
+            hop.dequeue_ns        = s.dequeue.load( std::memory_order_relaxed );
+            hop.finish_ns         = s.finish.load( std::memory_order_relaxed );
+            hop.thread            = thread;
+            std::atomic_thread_fence( std::memory_order_acquire );
+            if ( s.seq.load( std::memory_order_relaxed ) == 2 * i + 2 ) {
+                out.push_back( hop );
+            }
+        }
+    }
+
+private:
+    // Fields are atomics only so a concurrent reader is not a data race;
+    // every access is relaxed.
+    struct slot {
+        std::atomic<std::uint64_t> seq{ 0 };
+        std::atomic<const char *> actor{ nullptr };
+        std::atomic<std::uint64_t> trace{ 0 }, span{ 0 }, parent{ 0 };
+        std::atomic<std::uint32_t> poster{ 0 };
+        std::atomic<std::uint64_t> enqueue{ 0 }, dequeue{ 0 }, finish{ 0 };
+    };
+
+    const std::uint32_t thread;
+    std::unique_ptr<slot[]> slots;
+    std::atomic<std::uint64_t> head{ 0 };
+};
+
+class ActorTracer {
+public:
+    // Trace one in every n messages posted from outside a handler; 0 stops
+    // starting new traces. Defaults to 1 (everything).
+    static void SetSampleEvery( std::uint32_t n ) {
+        SampleEvery().store( n, std::memory_order_relaxed );
+    }
+
+    // Context for a message being posted by the calling thread.
+    static TraceContext OnPost() {
+        ThreadState &state = State();
+        TraceContext ctx;
+        ctx.poster = state.thread;
+        if ( state.in_handler ) {
+            ctx.trace_id  = state.current.trace_id;
+            ctx.parent_id = state.current.span_id;
+        } else {
+            std::uint32_t every = SampleEvery().load( std::memory_order_relaxed );
+            if ( every != 0 && ++state.roots % every == 0 ) {
+                ctx.trace_id = NextId( state );
+            }
+        }
+        if ( ctx.trace_id != 0 ) {
+            ctx.span_id = NextId( state );
+        }
+        return ctx;
+    }
+
+    // Brackets DealMsg so the messages it posts join ctx's trace.
+    static void Enter( const TraceContext &ctx ) {
+        ThreadState &state = State();
+        state.current      = ctx;
+        state.in_handler   = true;
+    }
+
+    static void Leave( const char *actor, const TraceContext &ctx, std::uint64_t enqueue_ns,
+        std::uint64_t dequeue_ns, std::uint64_t finish_ns ) {
+        ThreadState &state = State();
+        state.in_handler   = false;
+        if ( ctx.trace_id == 0 ) {
+            return;
+        }
+        if ( !state.ring ) {
+            state.ring = std::make_shared<TraceRing>( state.thread );
+            std::lock_guard<std::mutex> lock( RegistryMutex() );
+            Registry().push_back( state.ring );
+        }
+        state.ring->Push( actor, ctx, enqueue_ns, dequeue_ns, finish_ns );
+    }
+
+    // Recorded hops of every thread, including threads that have exited,
+    // oldest first.
+    static std::vector<TraceHop> Collect() {
+        std::vector<TraceHop> hops;
+        {
+            std::lock_guard<std::mutex> lock( RegistryMutex() );
+            for ( auto &ring : Registry() ) {
+                ring->CopyTo( hops );
+            }
+        }
+        std::sort( hops.begin(), hops.end(), []( const TraceHop &a, const TraceHop &b ) {
+            return a.dequeue_ns < b.dequeue_ns;
+        } );
+        return hops;
+    }
+
+    // Per hop: a complete event for the handler on the thread that ran it,
+    // an async event for the time spent queued, and a flow arrow from the
+    // sender to the handler. Times are microseconds from the earliest hop.
+    static void ExportChromeTrace( std::ostream &os ) {
+        std::vector<TraceHop> hops = Collect();
+        std::uint64_t origin       = ~std::uint64_t( 0 );
+        for ( const auto &hop : hops ) {
+            origin = std::min( origin, hop.enqueue_ns );
+        }
+        auto us = [origin]( std::uint64_t ns ) { return ( ns - origin ) / 1000.0; };
+
+        os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        const char *sep = "";
+        for ( const auto &hop : hops ) {
+            const TraceContext &ctx = hop.context;
+            os << sep << "{\"name\":\"";
+            Escape( os, hop.actor );
+            os << "\",\"cat\":\"handler\",\"ph\":\"X\",\"pid\":1,\"tid\":" << hop.thread
+               << ",\"ts\":" << us( hop.dequeue_ns )
+               << ",\"dur\":" << ( hop.finish_ns - hop.dequeue_ns ) / 1000.0
+               << ",\"args\":{\"trace\":" << ctx.trace_id << ",\"span\":" << ctx.span_id
+               << ",\"parent\":" << ctx.parent_id
+               << ",\"queued_us\":" << ( hop.dequeue_ns - hop.enqueue_ns ) / 1000.0 << "}}";
+            sep = ",";
+
+            os << ",{\"name\":\"";
+            Escape( os, hop.actor );
+            os << " queued\",\"cat\":\"queue\",\"ph\":\"b\",\"id\":\"" << ctx.span_id
+               << "\",\"pid\":1,\"tid\":" << ctx.poster << ",\"ts\":" << us( hop.enqueue_ns )
+               << "},{\"name\":\"";
+            Escape( os, hop.actor );
+            os << " queued\",\"cat\":\"queue\",\"ph\":\"e\",\"id\":\"" << ctx.span_id
+               << "\",\"pid\":1,\"tid\":" << ctx.poster << ",\"ts\":" << us( hop.dequeue_ns )
+               << "}";
+
+            os << ",{\"name\":\"post\",\"cat\":\"flow\",\"ph\":\"s\",\"id\":\"" << ctx.span_id
+               << "\",\"pid\":1,\"tid\":" << ctx.poster << ",\"ts\":" << us( hop.enqueue_ns )
+               << "},{\"name\":\"post\",\"cat\":\"flow\",\"ph\":\"f\",\"bp\":\"e\",\"id\":\""
+               << ctx.span_id << "\",\"pid\":1,\"tid\":" << hop.thread
+               << ",\"ts\":" << us( hop.dequeue_ns ) << "}";
+        }
+        os << "]}\n";
+    }
+
+private:
+    struct ThreadState {
+        std::uint32_t thread = NextThread();
+        std::uint64_t next_id = 0;
+        std::uint32_t roots   = 0;
+        bool in_handler       = false;
+        TraceContext current;
+        std::shared_ptr<TraceRing> ring;
+    };
+
+    static ThreadState &State() {
+        thread_local ThreadState state;
+        return state;
+    }
+
+    static std::uint32_t NextThread() {
+        static std::atomic<std::uint32_t> next{ 1 };
+        return next.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    // Unique without a shared counter: thread id in the top bits.
+    static std::uint64_t NextId( ThreadState &state ) {
+        return ( std::uint64_t( state.thread ) << 40 ) | ++state.next_id;
+    }
+
+    static std::atomic<std::uint32_t> &SampleEvery() {
+        static std::atomic<std::uint32_t> every{ 1 };
+        return every;
+    }
+
+    // Rings outlive their threads so late exports still see them.
+    static std::vector<std::shared_ptr<TraceRing>> &Registry() {
+        static std::vector<std::shared_ptr<TraceRing>> registry;
+        return registry;
+    }
+
+    static std::mutex &RegistryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static void Escape( std::ostream &os, const char *text ) {
+        for ( ; text && *text; ++text ) {
+            if ( *text == '"' || *text == '\\' ) {
+                os << '\\';
+            }
+            os << *text;
+        }
+    }
+};
+
+#endif
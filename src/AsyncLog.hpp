@@ -0,0 +1,384 @@
+#pragma once
+
+#include <mutex>
+#include <tuple>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <condition_variable>
+#include <unistd.h>
+
+enum class LogLevel : int { Trace, Debug, Info, Warn, Error };
+
+// Calls below this level compile to nothing. Define it on the command
+// line, e.g. -DLOG_MIN_LEVEL=1 to keep Debug.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 2
+#endif
+
+namespace log_detail {
+
+struct record {
+    void ( *format )( void *args, std::ostream &os ); // nullptr for padding
+    std::uint32_t size;                               // including this header
+    std::uint64_t stamp;                              // steady clock, ns
+};
+
+inline std::uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() )
+        .count();
+}
+
+// Records are whole multiples of the header size, so even the smallest gap
+// before the end of a ring can hold a padding header.
+constexpr std::size_t header_size =
+    ( sizeof( record ) + alignof( std::max_align_t ) - 1 ) & ~( alignof( std::max_align_t ) - 1 );
+
+constexpr std::size_t round_up( std::size_t n ) {
+    return ( n + header_size - 1 ) / header_size * header_size;
+}
+
+// The captured arguments of one log call, formatted and destroyed in place
+// by the writer thread.
+template <typename... Args> struct payload {
+    std::tuple<Args...> args;
+
+    static void format( void *self, std::ostream &os ) {
+        auto *p = static_cast<payload *>( self );
+        std::apply( [&os]( const auto &...arg ) { ( os << ... << arg ); }, p->args );
+        p->~payload();
+    }
+};
+
+// Byte ring with one producer (the logging thread) and one consumer (the
+// writer). Records are contiguous; one that would straddle the end is
+// preceded by a padding record.
+class ring {
+public:
+    static constexpr std::size_t capacity = header_size << 12;
+
+    ring() : storage( new std::max_align_t[capacity / sizeof( std::max_align_t )] ) {}
+
+    // Returns space for a record of size bytes, or nullptr while full.
+    // Nothing is visible to the writer until commit.
+    record *reserve( std::size_t size ) {
+        std::uint64_t h    = head.load( std::memory_order_relaxed );
+        std::uint64_t t    = tail.load( std::memory_order_acquire );
+        std::size_t to_end = capacity - h % capacity;
+        std::size_t pad    = size > to_end ? to_end : 0;
+        if ( h + pad + size - t > capacity ) {
+            return nullptr;
+        }
+        if ( pad ) {
+            *at( h ) = record{ nullptr, static_cast<std::uint32_t>( pad ), 0 };
+            h += pad;
+        }
+        next_head = h + size;
+        return at( h );
+    }
+
+    void commit() { head.store( next_head, std::memory_order_release ); }
+
+    // Writer side: begin fixes the records this pass will consume, front
+    // returns the oldest of them (nullptr when done), pop formats it into
+    // os and end hands the space back to the producer.
+    void begin() {
+        read_pos = tail.load( std::memory_order_relaxed );
+        read_end = head.load( std::memory_order_acquire );
+    }
+
+    record *front() {
+        while ( read_pos != read_end ) {
+            record *rec = at( read_pos );
+            if ( rec->format ) {
+                return rec;
+            }
+            read_pos += rec->size;
+        }
+        return nullptr;
+    }
+
+    void pop( std::ostream &os ) {
+        record *rec = at( read_pos );
+        rec->format( reinterpret_cast<unsigned char *>( rec ) + header_size, os );
+        os << '\n';
+        read_pos += rec->size;
+    }
+
+    void end() { tail.store( read_pos, std::memory_order_release ); }
+
+    bool empty() const {
+        return tail.load( std::memory_order_acquire ) == head.load( std::memory_order_acquire );
+    }
+
+    std::atomic<bool> orphaned{ false }; // owning thread has exited
+    std::atomic<bool> writing{ false };  // producer is inside Write
+
+private:
+    std::unique_ptr<std::max_align_t[]> storage;
+    std::atomic<std::uint64_t> head{ 0 };
+    std::atomic<std::uint64_t> tail{ 0 };
+    std::uint64_t next_head = 0;
+    std::uint64_t read_pos = 0, read_end = 0;
+
+    record *at( std::uint64_t pos ) {
+        return reinterpret_cast<record *>(
+            reinterpret_cast<unsigned char *>( storage.get() ) + pos % capacity );
+    }
+};
+
+// Constant-initialized and trivially destructible, so both can still be
+// used during static destruction, after the logger itself is gone.
+inline std::atomic<bool> logger_alive{ false };
+inline std::atomic<int> log_fd{ STDOUT_FILENO };
+
+} // namespace log_detail
+
+// Process-wide asynchronous log sink. A log call copies its arguments into
+// a ring owned by the calling thread, with no lock and no formatting; a
+// background writer formats whatever has accumulated and hands it to the
+// file descriptor in one write() per batch. Each batch is merged across
+// threads by log time, so lines only come out of order when they straddle
+// two batches.
+//
+// Arguments are stored by value and formatted later with operator<<, so
+// they must be copyable, and a const char * must point to something that
+// lives forever (a literal); pass other text as std::string.
+class AsyncLogger {
+public:
+    static AsyncLogger &Inst() {
+        static AsyncLogger logger;
+        return logger;
+    }
+
+    // Writers that already saw the logger alive finish their record before
+    // the final pass, so nothing is committed after it; later ones write
+    // synchronously.
+    ~AsyncLogger() {
+        log_detail::logger_alive.store( false );
+        std::vector<std::shared_ptr<log_detail::ring>> snapshot;
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            snapshot = rings;
+        }
+        for ( auto &ring : snapshot ) {
+            while ( ring->writing.load() ) {
+                std::this_thread::yield();
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            bstop = true;
+        }
+        wake_cond.notify_all();
+        thread.join();
+    }
+
+    AsyncLogger( const AsyncLogger & )            = delete;
+    AsyncLogger &operator=( const AsyncLogger & ) = delete;
+
+    // fd is not owned; the default is standard output.
+    void SetFd( int fd ) { log_detail::log_fd.store( fd ); }
+
+    template <typename... Args> void Write( Args &&...args ) {
+        using payload = log_detail::payload<std::decay_t<Args>...>;
+        constexpr std::size_t size =
+            log_detail::header_size + log_detail::round_up( sizeof( payload ) );
+        if constexpr ( size > log_detail::ring::capacity / 2 ) {
+            // Too big to queue inline: format now and queue the text.
+            std::ostringstream os;
+            ( os << ... << args );
+            Write( os.str() );
+        } else {
+            if ( !log_detail::logger_alive.load( std::memory_order_relaxed ) ) {
+                WriteNow( std::forward<Args>( args )... );
+                return;
+            }
+            log_detail::ring &ring = LocalRing();
+            // Both seq_cst: either the destructor waits for this record or
+            // we see the logger going away.
+            ring.writing.store( true );
+            if ( !log_detail::logger_alive.load() ) {
+                ring.writing.store( false, std::memory_order_release );
+                WriteNow( std::forward<Args>( args )... );
+                return;
+            }
+            log_detail::record *rec;
+            while ( !( rec = ring.reserve( size ) ) ) {
+                // Full: let the writer catch up.
+                wake_cond.notify_one();
+                std::this_thread::yield();
+            }
+            rec->format = &payload::format;
+            rec->size   = static_cast<std::uint32_t>( size );
+            rec->stamp  = log_detail::now_ns();
+            ::new ( reinterpret_cast<unsigned char *>( rec ) + log_detail::header_size )
+                payload{ std::tuple<std::decay_t<Args>...>( std::forward<Args>( args )... ) };
+            ring.commit();
+            ring.writing.store( false, std::memory_order_release );
+        }
+    }
+
+    // Blocks until every line logged before the call has been written.
+    void Flush() {
+        std::unique_lock<std::mutex> lock( mutex );
+        // A pass already running may have missed our lines; then wait for
+        // the one after it.
+        std::uint64_t target = passes + ( waiting ? 1 : 2 );
+        flush_wanted         = true;
+        wake_cond.notify_all();
+        done_cond.wait( lock, [this, target] { return passes >= target || bstop; } );
+    }
+
+private:
+    // Idle back-off of the writer, doubling from min to max while there is
+    // nothing to write.
+    static constexpr std::chrono::milliseconds min_interval{ 1 };
+    static constexpr std::chrono::milliseconds max_interval{ 50 };
+
+    std::mutex mutex; // guards the ring list and the writer state below
+    std::condition_variable wake_cond, done_cond;
+    std::vector<std::shared_ptr<log_detail::ring>> rings;
+    std::uint64_t passes = 0;
+    bool flush_wanted    = false;
+    bool waiting         = false; // writer is between passes
+    bool bstop           = false;
+    std::thread thread;
+
+    AsyncLogger() {
+        log_detail::logger_alive.store( true );
+        thread = std::thread( [this]() { run(); } );
+    }
+
+    // Marks the ring orphaned when its thread exits; the writer frees it
+    // once drained.
+    struct ring_owner {
+        std::shared_ptr<log_detail::ring> ring;
+        ~ring_owner() {
+            if ( ring ) {
+                ring->orphaned.store( true );
+            }
+        }
+    };
+
+    log_detail::ring &LocalRing() {
+        thread_local ring_owner owner;
+        if ( !owner.ring ) {
+            owner.ring = std::make_shared<log_detail::ring>();
+            std::lock_guard<std::mutex> lock( mutex );
+            rings.push_back( owner.ring );
+        }
+        return *owner.ring;
+    }
+
+    template <typename... Args> static void WriteNow( Args &&...args ) {
+        std::ostringstream os;
+        ( os << ... << args ) << '\n';
+        WriteAll( os.str() );
+    }
+
+    static void WriteAll( const std::string &text ) {
+        const char *data = text.data();
+        std::size_t left = text.size();
+        while ( left > 0 ) {
+            ssize_t n = ::write( log_detail::log_fd.load(), data, left );
+            if ( n <= 0 ) {
+                return;
+            }
+            data += n;
+            left -= static_cast<std::size_t>( n );
+        }
+    }
+
+    void run() {
+        std::ostringstream batch;
+        std::vector<std::shared_ptr<log_detail::ring>> snapshot;
+        auto interval = min_interval;
+        std::unique_lock<std::mutex> lock( mutex );
+        for ( ;; ) {
+            bool stopping = bstop;
+            snapshot      = rings;
+            lock.unlock();
+
+            bool wrote = false;
+            batch.str( "" );
+            for ( auto &ring : snapshot ) {
+                ring->begin();
+            }
+            for ( ;; ) {
+                log_detail::ring *oldest = nullptr;
+                std::uint64_t stamp      = 0;
+                for ( auto &ring : snapshot ) {
+                    log_detail::record *rec = ring->front();
+                    if ( rec && ( !oldest || rec->stamp < stamp ) ) {
+                        oldest = ring.get();
+                        stamp  = rec->stamp;
+                    }
+                }
+                if ( !oldest ) {
+                    break;
+                }
+                oldest->pop( batch );
+                wrote = true;
+            }
+            for ( auto &ring : snapshot ) {
+                ring->end();
+            }
+            if ( wrote ) {
+                WriteAll( batch.str() );
+            }
+
+            lock.lock();
+            rings.erase( std::remove_if( rings.begin(), rings.end(),
+                             []( const std::shared_ptr<log_detail::ring> &ring ) {
+                                 return ring->orphaned.load() && ring->empty();
+                             } ),
+                rings.end() );
+            ++passes;
+            done_cond.notify_all();
+            if ( stopping ) {
+                return;
+            }
+            interval = wrote ? min_interval : std::min( max_interval, interval * 2 );
+            if ( !flush_wanted && !bstop ) {
+                waiting = true;
+                wake_cond.wait_for( lock, interval );
+                waiting = false;
+            }
+            flush_wanted = false;
+        }
+    }
+};
+
+// Deferred, level-filtered logging: Log<LogLevel::Info>( "x = ", x ).
+template <LogLevel Level, typename... Args> inline void Log( Args &&...args ) {
+    if constexpr ( static_cast<int>( Level ) >= LOG_MIN_LEVEL ) {
+        AsyncLogger::Inst().Write( std::forward<Args>( args )... );
+    }
+}
+
+template <typename... Args> inline void LogDebug( Args &&...args ) {
+    Log<LogLevel::Debug>( std::forward<Args>( args )... );
+}
+
+template <typename... Args> inline void LogInfo( Args &&...args ) {
+    Log<LogLevel::Info>( std::forward<Args>( args )... );
+}
+
+template <typename... Args> inline void LogWarn( Args &&...args ) {
+    Log<LogLevel::Warn>( std::forward<Args>( args )... );
+}
+
+template <typename... Args> inline void LogError( Args &&...args ) {
+    Log<LogLevel::Error>( std::forward<Args>( args )... );
+}
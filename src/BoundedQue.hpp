@@ -0,0 +1,333 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <condition_variable>
+#include "QueOps.hpp"
+#include "QueParker.hpp"
+#include "QueSlot.hpp"
+
+// What a push does when the mailbox already holds capacity messages.
+enum class OverflowPolicy {
+    Block,      // wait until the consumer makes room
+    FailFast,   // reject the new message
+    DropOldest, // evict the message at the head
+    Conflate,   // replace the queued message with the same key, else evict
+                // the oldest
+};
+
+// Bounded mailbox with a configurable overflow policy. Storage is a fixed
+// ring of inline slots, so memory is capped at capacity messages however
+// far the consumer falls behind.
+//
+// emplace/PushBulk return how much the queue depth grew, which is less
+// than the number of messages offered when some were rejected, replaced
+// or caused an eviction.
+template <typename T> class BoundedQue : public QueOps<BoundedQue<T>, T> {
+public:
+    // Called outside the queue lock with the current depth, once when the
+    // depth reaches the high watermark and again when it falls back to the
+    // low one.
+    using DepthCallback = std::function<void( std::size_t depth, bool above )>;
+    using KeyFunc       = std::function<std::size_t( const T & )>;
+
+    explicit BoundedQue( std::size_t capacity = 1024,
+        OverflowPolicy policy = OverflowPolicy::Block ) {
+        SetCapacity( capacity, policy );
+    }
+
+    ~BoundedQue() { clear(); }
+
+    BoundedQue( const BoundedQue & )            = delete;
+    BoundedQue &operator=( const BoundedQue & ) = delete;
+
+    // Configuration calls must happen before the queue is shared.
+    void SetCapacity( std::size_t capacity, OverflowPolicy policy ) {
+        clear();
+        cap      = capacity ? capacity : 1;
+        overflow = policy;
+        slots.reset( new slot[cap] );
+        keys.reset( new std::size_t[cap] );
+    }
+
+    void SetConflateKey( KeyFunc func ) { key_func = std::move( func ); }
+
+    void SetDepthWatermarks(
+        std::size_t high, std::size_t low, DepthCallback callback ) {
+        high_mark   = high;
+        low_mark    = low < high ? low : high;
+        on_depth    = std::move( callback );
+        above_water = false;
+    }
+
+    std::size_t capacity() const { return cap; }
+
+    std::size_t size() const { return depth.load( std::memory_order_relaxed ); }
+
+    // Messages rejected, evicted or conflated away so far.
+    std::uint64_t dropped() const { return drops.load( std::memory_order_relaxed ); }
+
+    void NotifyStop() {
+        QueOps<BoundedQue<T>, T>::NotifyStop();
+        { std::lock_guard<std::mutex> lock( mutex ); }
+        not_full.notify_all();
+    }
+
+    bool empty() const { return size() == 0; }
+
+    template <typename... Args> std::size_t emplace( Args &&...args ) {
+        std::size_t grew;
+        int event;
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            grew  = offer( lock, overflow, std::forward<Args>( args )... );
+            event = depth_event();
+        }
+        finish_push( grew, event );
+        return grew;
+    }
+
+    // Never blocks or evicts. Returns true only if the depth grew, so a
+    // message merged into a queued one with the same key also reports
+    // false (retrying it just merges again).
+    template <typename... Args> bool TryEmplace( Args &&...args ) {
+        std::size_t grew;
+        int event;
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            grew  = offer( lock, OverflowPolicy::FailFast,
+                 std::forward<Args>( args )... );
+            event = depth_event();
+        }
+        finish_push( grew, event );
+        return grew != 0;
+    }
+
+    // Under OverflowPolicy::Block, messages linked so far are announced
+    // before waiting for room, since only a woken consumer can make it.
+    template <typename Range> std::size_t PushBulk( Range &&range ) {
+        std::size_t grew = 0, pending = 0;
+        int event;
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            for ( auto &&elm : range ) {
+                if ( pending > 0 && count == cap && overflow == OverflowPolicy::Block ) {
+                    parker.wake( pending );
+                    pending = 0;
+                }
+                std::size_t added;
+                if constexpr ( std::is_lvalue_reference_v<Range> ) {
+                    added = offer( lock, overflow, elm );
+                } else {
+                    added = offer( lock, overflow, std::move( elm ) );
+                }
+                grew += added;
+                pending += added;
+            }
+            event = depth_event();
+        }
+        finish_push( pending, event );
+        return grew;
+    }
+
+private:
+    friend class QueOps<BoundedQue<T>, T>;
+
+    struct slot {
+        alignas( T ) unsigned char storage[sizeof( T )];
+
+        T *value() { return std::launder( reinterpret_cast<T *>( storage ) ); }
+    };
+
+    enum { no_event, went_above, went_below };
+
+    std::mutex mutex;
+    std::condition_variable not_full;
+    QueParker parker;
+    std::unique_ptr<slot[]> slots;
+    std::unique_ptr<std::size_t[]> keys;
+    std::size_t cap = 0;
+    std::uint64_t head_seq = 0;
+    std::size_t count      = 0;
+    std::size_t blocked    = 0;
+    std::atomic<std::size_t> depth{ 0 };
+    std::atomic<std::uint64_t> drops{ 0 };
+    std::atomic<bool> bstop{ false };
+    OverflowPolicy overflow = OverflowPolicy::Block;
+    KeyFunc key_func;
+    // key -> sequence number of the queued message carrying it.
+    std::unordered_map<std::size_t, std::uint64_t> keyed;
+    std::size_t high_mark = 0, low_mark = 0;
+    bool above_water      = false;
+    DepthCallback on_depth;
+
+    bool conflating() const { return overflow == OverflowPolicy::Conflate && key_func; }
+
+    slot &at( std::uint64_t seq ) { return slots[seq % cap]; }
+
+    // Caller holds mutex.
+    void pop_front() {
+        if ( conflating() ) {
+            auto it = keyed.find( keys[head_seq % cap] );
+            if ( it != keyed.end() && it->second == head_seq ) {
+                keyed.erase( it );
+            }
+        }
+        at( head_seq ).value()->~T();
+        ++head_seq;
+        --count;
+    }
+
+    // Caller holds mutex; returns how much the depth grew.
+    template <typename... Args>
+    std::size_t offer( std::unique_lock<std::mutex> &lock,
+        OverflowPolicy policy, Args &&...args ) {
+        if ( bstop.load() ) {
+            return 0;
+        }
+        if ( !conflating() ) {
+            if ( count == cap && !make_room( lock, policy ) ) {
+                return 0;
+            }
+            bool grew = count < cap;
+            if ( !grew ) {
+                evict_oldest();
+            }
+            link( std::forward<Args>( args )... );
+            return grew ? 1 : 0;
+        }
+        // Replacing a queued message needs no room, so even TryEmplace
+        // conflates.
+        T value         = make_msg<T>( std::forward<Args>( args )... );
+        std::size_t key = key_func( value );
+        auto it         = keyed.find( key );
+        if ( it != keyed.end() ) {
+            *at( it->second ).value() = std::move( value );
+            drops.fetch_add( 1, std::memory_order_relaxed );
+            return 0;
+        }
+        if ( count == cap && !make_room( lock, policy ) ) {
+            return 0;
+        }
+        bool grew = count < cap;
+        if ( !grew ) {
+            evict_oldest();
+        }
+        keys[( head_seq + count ) % cap] = key;
+        keyed.emplace( key, head_seq + count );
+        link( std::move( value ) );
+        return grew ? 1 : 0;
+    }
+
+    // Called with the queue full. Returns false if the message must be
+    // dropped; otherwise either a slot is free or the caller may evict.
+    bool make_room( std::unique_lock<std::mutex> &lock, OverflowPolicy policy ) {
+        switch ( policy ) {
+        case OverflowPolicy::Block:
+            ++blocked;
+            not_full.wait( lock, [this] { return bstop.load() || count < cap; } );
+            --blocked;
+            return !bstop.load();
+        case OverflowPolicy::FailFast:
+            drops.fetch_add( 1, std::memory_order_relaxed );
+            return false;
+        default:
+            return true;
+        }
+    }
+
+    void evict_oldest() {
+        pop_front();
+        drops.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    template <typename... Args> void link( Args &&...args ) {
+        construct_slot<T>( at( head_seq + count ).storage,
+            std::forward<Args>( args )... );
+        ++count;
+        depth.store( count, std::memory_order_release );
+    }
+
+    // Caller holds mutex.
+    int depth_event() {
+        if ( !on_depth ) {
+            return no_event;
+        }
+        if ( !above_water && count >= high_mark ) {
+            above_water = true;
+            return went_above;
+        }
+        if ( above_water && count <= low_mark ) {
+            above_water = false;
+            return went_below;
+        }
+        return no_event;
+    }
+
+    void fire( int event ) {
+        if ( event != no_event ) {
+            on_depth( size(), event == went_above );
+        }
+    }
+
+    void finish_push( std::size_t grew, int event ) {
+        if ( grew > 0 ) {
+            parker.wake( grew );
+        }
+        fire( event );
+    }
+
+    template <typename Func> std::size_t consume_batch( std::size_t max, Func &&func ) {
+        std::size_t popped = 0;
+        int event;
+        bool wake_producers;
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            if ( bstop.load() ) {
+                return 0;
+            }
+            while ( popped < max && count > 0 ) {
+                slot &s = at( head_seq );
+                func( std::move( *s.value() ) );
+                pop_front();
+                ++popped;
+            }
+            depth.store( count, std::memory_order_relaxed );
+            event          = depth_event();
+            wake_producers = popped > 0 && blocked > 0;
+        }
+        if ( wake_producers ) {
+            not_full.notify_all();
+        }
+        fire( event );
+        return popped;
+    }
+
+    void wait_for_data() {
+        auto ready = [this] {
+            return bstop.load() || depth.load( std::memory_order_acquire ) > 0;
+        };
+        if ( !parker.spin( ready ) ) {
+            parker.park( ready );
+        }
+    }
+
+    template <typename Func> bool try_consume( Func &&func ) {
+        return consume_batch( 1, func ) != 0;
+    }
+
+    void clear() {
+        while ( count > 0 ) {
+            pop_front();
+        }
+        keyed.clear();
+        depth.store( 0 );
+    }
+};
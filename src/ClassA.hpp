@@ -15,33 +15,21 @@ class ClassA : public ActorSingle<ClassA, MsgClassA> {
 
 public:
     ~ClassA() {
-        _bstop = true;
-        _que.NotifyStop();
-        _thread.join();
-        std::cout << "ClassA destruct " << std::endl;
+        StopWorker();
+        LogInfo( "ClassA destruct " );
     }
 
-    void DealMsg( std::shared_ptr<MsgClassA> data ) {
-        std::cout << "class A deal msg is " << *data << std::endl;
+    void DealMsg( const MsgClassA &data ) {
+        LogInfo( "class A deal msg is ", data );
 
-        MsgClassB msga;
-        msga.name = "llfc";
-        ClassB::Inst().PostMsg( msga );
+        ClassB::Inst().EmplaceMsg( "llfc" );
     }
 
 private:
-    ClassA() {
-        _thread = std::thread( [this]() {
-            for ( ; ( _bstop.load() == false ); ) {
-                std::shared_ptr<MsgClassA> data = _que.WaitAndPop();
-                if ( data == nullptr ) {
-                    continue;
-                }
-
-                DealMsg( data );
-            }
-
-            std::cout << "ClassA thread exit " << std::endl;
-        } );
+    ClassA() : ActorSingle( "ClassA" ) {
+        // Construct ClassB first so it is destroyed after our worker,
+        // which posts to it, has been stopped.
+        ClassB::Inst();
+        StartThread();
     }
 };
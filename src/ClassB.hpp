@@ -10,38 +10,28 @@ struct MsgClassB {
     }
 };
 
-class ClassB : public ActorSingle<ClassB, MsgClassB> {
-    friend class ActorSingle<ClassB, MsgClassB>;
+// Only ClassA's worker posts here, so the mailbox can be single-producer;
+// debug builds assert if any other thread posts.
+class ClassB : public ActorSingle<ClassB, MsgClassB, SpscQue> {
+    friend class ActorSingle<ClassB, MsgClassB, SpscQue>;
 
 public:
     ~ClassB() {
-        _bstop = true;
-        _que.NotifyStop();
-        _thread.join();
-        std::cout << "ClassB destruct " << std::endl;
+        StopWorker();
+        LogInfo( "ClassB destruct " );
     }
 
-    void DealMsg( std::shared_ptr<MsgClassB> data ) {
-        std::cout << "class B deal msg is " << *data << std::endl;
+    void DealMsg( const MsgClassB &data ) {
+        LogInfo( "class B deal msg is ", data );
 
-        MsgClassC msga;
-        msga.name = "llfc";
-        ClassC::Inst().PostMsg( msga );
+        ClassC::Inst().EmplaceMsg( "llfc" );
     }
 
 private:
-    ClassB() {
-        _thread = std::thread( [this]() {
-            for ( ; ( _bstop.load() == false ); ) {
-                std::shared_ptr<MsgClassB> data = _que.WaitAndPop();
-                if ( data == nullptr ) {
-                    continue;
-                }
-
-                DealMsg( data );
-            }
-
-            std::cout << "ClassB thread exit " << std::endl;
-        } );
+    ClassB() : ActorSingle( "ClassB" ) {
+        // Construct ClassC first so it is destroyed after our worker,
+        // which posts to it, has been stopped.
+        ClassC::Inst();
+        StartThread();
     }
 };
@@ -9,34 +9,23 @@ struct MsgClassC {
     }
 };
 
-class ClassC : public ActorSingle<ClassC, MsgClassC> {
-    friend class ActorSingle<ClassC, MsgClassC>;
+// Only ClassB's worker posts here, so the mailbox can be single-producer;
+// debug builds assert if any other thread posts.
+class ClassC : public ActorSingle<ClassC, MsgClassC, SpscQue> {
+    friend class ActorSingle<ClassC, MsgClassC, SpscQue>;
 
 public:
     ~ClassC() {
-        _bstop = true;
-        _que.NotifyStop();
-        _thread.join();
-        std::cout << "ClassC destruct " << std::endl;
+        StopWorker();
+        LogInfo( "ClassC destruct " );
     }
 
-    void DealMsg( std::shared_ptr<MsgClassC> data ) {
-        std::cout << "class C deal msg is " << *data << std::endl;
+    void DealMsg( const MsgClassC &data ) {
+        LogInfo( "class C deal msg is ", data );
     }
 
 private:
-    ClassC() {
-        _thread = std::thread( [this]() {
-            for ( ; ( _bstop.load() == false ); ) {
-                std::shared_ptr<MsgClassC> data = _que.WaitAndPop();
-                if ( data == nullptr ) {
-                    continue;
-                }
-
-                DealMsg( data );
-            }
-
-            std::cout << "ClassC thread exit " << std::endl;
-        } );
+    ClassC() : ActorSingle( "ClassC" ) {
+        StartThread();
     }
 };
@@ -0,0 +1,259 @@
+#pragma once
+
+#if !defined( __cpp_impl_coroutine )
+#error "CoActor.hpp needs C++20 coroutines (-std=c++20)"
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <optional>
+#include <exception>
+#include <coroutine>
+#include "ThreadSafeQue.hpp"
+#include "WorkStealingPool.hpp"
+
+// Coroutine returned by a CoActor's Run(). It starts suspended and the
+// owning actor keeps the frame alive until it has finished.
+class CoTask {
+public:
+    struct promise_type {
+        std::atomic<bool> *done = nullptr;
+
+        CoTask get_return_object() {
+            return CoTask( std::coroutine_handle<promise_type>::from_promise( *this ) );
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        // The owner may destroy the frame as soon as done is set; the frame
+        // counts as suspended once await_suspend runs, so that is safe.
+        auto final_suspend() noexcept {
+            struct final_awaiter {
+                bool await_ready() noexcept { return false; }
+                void await_suspend( std::coroutine_handle<promise_type> h ) noexcept {
+                    if ( h.promise().done ) {
+                        h.promise().done->store( true, std::memory_order_release );
+                    }
+                }
+                void await_resume() noexcept {}
+            };
+            return final_awaiter{};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    CoTask() = default;
+
+    CoTask( CoTask &&other ) noexcept : handle( std::exchange( other.handle, nullptr ) ) {}
+
+    CoTask &operator=( CoTask &&other ) noexcept {
+        if ( this != &other ) {
+            reset();
+            handle = std::exchange( other.handle, nullptr );
+        }
+        return *this;
+    }
+
+    ~CoTask() { reset(); }
+
+    explicit operator bool() const { return static_cast<bool>( handle ); }
+
+private:
+    template <typename, typename> friend class CoActor;
+
+    explicit CoTask( std::coroutine_handle<promise_type> h ) : handle( h ) {}
+
+    void reset() {
+        if ( handle ) {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Mailbox whose consumer is a coroutine. receive() suspends the caller
+// without holding a thread; a post that finds it suspended resumes it on
+// the pool. At most one coroutine may receive from a mailbox.
+template <typename T> class CoMailbox {
+public:
+    explicit CoMailbox( WorkStealingPool &pool = WorkStealingPool::Default() )
+        : pool( pool ) {}
+
+    CoMailbox( const CoMailbox & )            = delete;
+    CoMailbox &operator=( const CoMailbox & ) = delete;
+
+    void Post( T value ) { Emplace( std::move( value ) ); }
+
+    template <typename... Args> void Emplace( Args &&...args ) {
+        que.emplace( std::forward<Args>( args )... );
+        wake();
+    }
+
+    // Queued messages are dropped and receive() yields std::nullopt from
+    // now on.
+    void Close() {
+        closed.store( true );
+        que.NotifyStop();
+        wake();
+    }
+
+    // co_await mailbox.receive() -> std::optional<T>, empty once closed.
+    auto receive() {
+        struct awaiter {
+            CoMailbox &box;
+            std::optional<T> value;
+            std::uint64_t seen = 0;
+
+            // seen is read before the queue, so a post the check misses
+            // has moved the state on by the time we try to suspend.
+            bool await_ready() {
+                seen = box.state.load();
+                return box.try_take( value ) || box.closed.load();
+            }
+
+            // Once the CAS publishes the handle a producer may resume us on
+            // another thread, so nothing here is touched after it succeeds.
+            bool await_suspend( std::coroutine_handle<> h ) {
+                CoMailbox &b      = box;
+                std::uint64_t cur = seen;
+                b.waiter          = h;
+                b.slot            = &value;
+                while ( !b.state.compare_exchange_strong( cur, cur | 1 ) ) {
+                    // Something was posted or the box closed since cur.
+                    if ( b.try_take( value ) || b.closed.load() ) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            // A suspended receiver is only resumed with value filled in or
+            // once the box is closed; see deliver().
+            std::optional<T> await_resume() { return std::move( value ); }
+        };
+        return awaiter{ *this, std::nullopt };
+    }
+
+    // Runs h on the pool.
+    void Resume( std::coroutine_handle<> h ) {
+        pool.Submit( [h]() { h.resume(); } );
+    }
+
+    WorkStealingPool &Pool() { return pool; }
+
+private:
+    // Lets ThreadSafeQue::DrainTo fill an optional, so T needs no default
+    // constructor.
+    struct one_slot {
+        using value_type = T;
+        std::optional<T> &slot;
+        void push_back( T &&v ) { slot.emplace( std::move( v ) ); }
+    };
+
+    WorkStealingPool &pool;
+    ThreadSafeQue<T> que;
+    // Bit 0 is set while the receiver is suspended in waiter; every post
+    // and every suspension moves the rest on, so a stale value never
+    // compares equal (no ABA on a reused coroutine frame).
+    std::atomic<std::uint64_t> state{ 0 };
+    std::coroutine_handle<> waiter;
+    std::optional<T> *slot = nullptr; // the suspended receiver's value
+    std::atomic<bool> closed{ false };
+
+    bool try_take( std::optional<T> &value ) {
+        one_slot out{ value };
+        return que.DrainTo( out, 1 ) != 0;
+    }
+
+    // Takes a suspended receiver off the state word (odd -> next even) and
+    // hands it to the pool, or just advances the state so a receiver about
+    // to suspend retries.
+    void wake() {
+        std::uint64_t cur = state.load();
+        while ( !state.compare_exchange_weak( cur, ( cur | 1 ) + 1 ) ) {
+        }
+        if ( cur & 1 ) {
+            pool.Submit( [this]() { deliver(); } );
+        }
+    }
+
+    // Runs on the pool for a receiver taken off the state word. The message
+    // that woke it may already have been taken by its previous receive(),
+    // so it is resumed only with a value or once closed, and otherwise goes
+    // back to waiting exactly as await_suspend would.
+    void deliver() {
+        for ( ;; ) {
+            std::uint64_t cur = state.load();
+            if ( try_take( *slot ) || closed.load() ) {
+                waiter.resume();
+                return;
+            }
+            if ( state.compare_exchange_strong( cur, cur | 1 ) ) {
+                return;
+            }
+        }
+    }
+};
+
+// Actor whose handler is a coroutine:
+//
+//   CoTask Run() {
+//       while ( auto msg = co_await _mailbox.receive() ) { ... }
+//   }
+//
+// Between messages the actor is just its coroutine frame and mailbox, so
+// tens of thousands of them can share the few threads of a
+// WorkStealingPool. As with ActorSingle, the derived class calls
+// StartWorker from its constructor and StopWorker from its destructor;
+// messages are never handled concurrently for one actor.
+template <typename ClassType, typename QueType> class CoActor {
+public:
+    void PostMsg( const QueType &data ) { _mailbox.Emplace( data ); }
+
+    void PostMsg( QueType &&data ) { _mailbox.Emplace( std::move( data ) ); }
+
+    template <typename... Args> void EmplaceMsg( Args &&...args ) {
+        _mailbox.Emplace( std::forward<Args>( args )... );
+    }
+
+protected:
+    explicit CoActor( WorkStealingPool &pool = WorkStealingPool::Default() )
+        : _mailbox( pool ) {}
+
+    CoActor( const CoActor & )            = delete;
+    CoActor &operator=( const CoActor & ) = delete;
+
+    void StartWorker() {
+        _task = static_cast<ClassType *>( this )->Run();
+        _task.handle.promise().done = &_done;
+        _mailbox.Resume( _task.handle );
+    }
+
+    // Closes the mailbox and waits for Run to return, helping the pool
+    // meanwhile so this also works from one of its threads.
+    void StopWorker() {
+        if ( !_task ) {
+            return;
+        }
+        _mailbox.Close();
+        while ( !_done.load( std::memory_order_acquire ) ) {
+            if ( !_mailbox.Pool().TryRunOne() ) {
+                std::this_thread::yield();
+            }
+        }
+        _task = CoTask();
+    }
+
+    CoMailbox<QueType> _mailbox;
+
+private:
+    CoTask _task;
+    std::atomic<bool> _done{ false };
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+#if defined( __linux__ )
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// CPUs a worker thread may run on; empty means leave it to the scheduler.
+// Placement is only implemented on Linux and is a no-op elsewhere.
+struct CpuSet {
+    std::vector<int> cpus;
+
+    bool empty() const { return cpus.empty(); }
+
+    static CpuSet Cpu( int cpu ) { return CpuSet{ { cpu } }; }
+
+    // CPUs this process may run on, which inside a container or under
+    // taskset can be far fewer than hardware_concurrency.
+    static CpuSet Allowed() {
+        CpuSet set;
+#if defined( __linux__ )
+        cpu_set_t mask;
+        CPU_ZERO( &mask );
+        if ( sched_getaffinity( 0, sizeof( mask ), &mask ) == 0 ) {
+            for ( int cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+                if ( CPU_ISSET( cpu, &mask ) ) {
+                    set.cpus.push_back( cpu );
+                }
+            }
+        }
+#endif
+        return set;
+    }
+
+    // CPUs of one NUMA node, read from sysfs; empty if unknown.
+    static CpuSet NumaNode( int node ) {
+        CpuSet set;
+#if defined( __linux__ )
+        std::string path = "/sys/devices/system/node/node" + std::to_string( node ) + "/cpulist";
+        if ( std::FILE *file = std::fopen( path.c_str(), "r" ) ) {
+            // "0-3,8-11"
+            int first, last;
+            char sep;
+            while ( std::fscanf( file, "%d", &first ) == 1 ) {
+                last = first;
+                if ( std::fscanf( file, "%c", &sep ) == 1 && sep == '-' ) {
+                    if ( std::fscanf( file, "%d", &last ) != 1 ) {
+                        break;
+                    }
+                    if ( std::fscanf( file, "%c", &sep ) != 1 ) {
+                        sep = '\n';
+                    }
+                }
+                for ( int cpu = first; cpu <= last; ++cpu ) {
+                    set.cpus.push_back( cpu );
+                }
+                if ( sep != ',' ) {
+                    break;
+                }
+            }
+            std::fclose( file );
+        }
+#else
+        (void)node;
+#endif
+        return set;
+    }
+
+    // At least 1, also where NUMA information is unavailable.
+    static int NumaNodeCount() {
+        int count = 0;
+        while ( !NumaNode( count ).empty() ) {
+            ++count;
+        }
+        return count > 0 ? count : 1;
+    }
+};
+
+// Restricts the calling thread to set. Returns false if set is empty or
+// the platform refused (for example a CPU outside the allowed mask).
+inline bool PinCurrentThread( const CpuSet &set ) {
+#if defined( __linux__ )
+    if ( set.empty() ) {
+        return false;
+    }
+    cpu_set_t mask;
+    CPU_ZERO( &mask );
+    for ( int cpu : set.cpus ) {
+        if ( cpu >= 0 && cpu < CPU_SETSIZE ) {
+            CPU_SET( cpu, &mask );
+        }
+    }
+    return pthread_setaffinity_np( pthread_self(), sizeof( mask ), &mask ) == 0;
+#else
+    (void)set;
+    return false;
+#endif
+}
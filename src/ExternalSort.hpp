@@ -0,0 +1,321 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Strategy_Method.hpp"
+#include "WorkStealingPool.hpp"
+
+namespace strategy {
+
+namespace external_detail {
+
+inline std::system_error error( const std::string &what ) {
+    return std::system_error( errno, std::generic_category(), what );
+}
+
+struct file {
+    int fd = -1;
+
+    file() = default;
+    explicit file( int fd ) : fd( fd ) {}
+    file( const file & )            = delete;
+    file &operator=( const file & ) = delete;
+    ~file() { reset(); }
+
+    void reset() {
+        if ( fd >= 0 ) {
+            ::close( fd );
+            fd = -1;
+        }
+    }
+};
+
+struct mapping {
+    void *addr       = nullptr;
+    std::size_t size = 0;
+
+    mapping() = default;
+    mapping( const mapping & )            = delete;
+    mapping &operator=( const mapping & ) = delete;
+    ~mapping() { reset(); }
+
+    // Read-only view of the first size bytes of fd; size 0 maps nothing.
+    void map( int fd, std::size_t bytes, const std::string &what ) {
+        reset();
+        if ( bytes == 0 ) {
+            return;
+        }
+        void *p = ::mmap( nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( p == MAP_FAILED ) {
+            throw error( "mmap " + what );
+        }
+        addr = p;
+        size = bytes;
+        ::madvise( addr, size, MADV_SEQUENTIAL );
+    }
+
+    void reset() {
+        if ( addr ) {
+            ::munmap( addr, size );
+            addr = nullptr;
+            size = 0;
+        }
+    }
+
+    // Drops the cached pages wholly inside [0, bytes), which were already
+    // consumed, so a long stream keeps a bounded resident set.
+    void release_before( std::size_t bytes ) {
+        std::size_t page = static_cast<std::size_t>( ::sysconf( _SC_PAGESIZE ) );
+        bytes            = bytes / page * page;
+        if ( addr && bytes > 0 ) {
+            ::madvise( addr, bytes, MADV_DONTNEED );
+        }
+    }
+};
+
+inline void write_all( int fd, const void *data, std::size_t size, const std::string &what ) {
+    const char *p = static_cast<const char *>( data );
+    while ( size > 0 ) {
+        ssize_t n = ::write( fd, p, size );
+        if ( n < 0 ) {
+            if ( errno == EINTR ) continue;
+            throw error( "write " + what );
+        }
+        p += n;
+        size -= static_cast<std::size_t>( n );
+    }
+}
+
+// Tournament of losers over k sorted runs: each node keeps the run that
+// lost the match played there and the overall winner sits in tree[0], so
+// replacing the smallest record costs one pass from its leaf to the root,
+// log k comparisons with no swaps of records. Exhausted runs lose every
+// match; ties go to the earlier run, which keeps the merge stable.
+template <typename Record> class loser_tree {
+public:
+    struct run {
+        const Record *pos, *end;
+    };
+
+    explicit loser_tree( std::vector<run> runs ) : runs( std::move( runs ) ) {
+        std::size_t k = this->runs.size();
+        tree.assign( std::max<std::size_t>( k, 1 ), 0 );
+        // Winners of every subtree, leaves at k .. 2k - 1.
+        std::vector<std::size_t> winner( 2 * k );
+        for ( std::size_t i = 0; i < k; ++i ) {
+            winner[k + i] = i;
+        }
+        for ( std::size_t node = k; node-- > 1; ) {
+            std::size_t a = winner[2 * node], b = winner[2 * node + 1];
+            if ( !beats( a, b ) ) {
+                std::swap( a, b );
+            }
+            winner[node] = a;
+            tree[node]   = b;
+        }
+        tree[0] = k > 1 ? winner[1] : 0;
+    }
+
+    bool empty() const { return runs.empty() || runs[tree[0]].pos == runs[tree[0]].end; }
+
+    const Record &top() const { return *runs[tree[0]].pos; }
+
+    void pop() {
+        std::size_t w = tree[0];
+        ++runs[w].pos;
+        for ( std::size_t node = ( w + runs.size() ) / 2; node >= 1; node /= 2 ) {
+            if ( beats( tree[node], w ) ) {
+                std::swap( tree[node], w );
+            }
+        }
+        tree[0] = w;
+    }
+
+private:
+    std::vector<run> runs;
+    std::vector<std::size_t> tree;
+
+    bool beats( std::size_t a, std::size_t b ) const {
+        if ( runs[a].pos == runs[a].end ) return false;
+        if ( runs[b].pos == runs[b].end ) return true;
+        if ( *runs[a].pos < *runs[b].pos ) return true;
+        if ( *runs[b].pos < *runs[a].pos ) return false;
+        return a < b;
+    }
+};
+
+} // namespace external_detail
+
+// Sorts a file of fixed-size records that may be far larger than memory.
+// The input is streamed through a buffer of memory_bytes; each chunk is
+// cut into one piece per pool worker, the pieces are sorted in parallel
+// by RunStrategy and spilled as sorted runs to one unlinked temporary
+// file. All runs are then mapped and merged in a single pass through a
+// loser tree, in 1 MiB output writes. When the input fits in the buffer
+// nothing is spilled and the pieces are merged straight from memory.
+//
+// Records are raw bytes of a trivially copyable type ordered by
+// operator<. Reading finishes before the output is opened, so input and
+// output may be the same file. I/O errors throw std::system_error.
+template <typename Record, typename RunStrategy = Auto_Sorting<Record *>>
+class External_Sorting {
+public:
+    static_assert( std::is_trivially_copyable<Record>::value,
+        "External_Sorting stores records as raw bytes" );
+
+    // An empty temp_dir means $TMPDIR, or /tmp if unset.
+    explicit External_Sorting( std::size_t memory_bytes = std::size_t( 256 ) << 20,
+        std::string temp_dir = std::string(),
+        WorkStealingPool &pool = WorkStealingPool::Default() )
+        : chunk_records( std::max<std::size_t>( 1, memory_bytes / sizeof( Record ) ) ),
+          temp_dir( std::move( temp_dir ) ), pool( pool ) {
+        if ( this->temp_dir.empty() ) {
+            const char *env = std::getenv( "TMPDIR" );
+            this->temp_dir  = env && *env ? env : "/tmp";
+        }
+    }
+
+    void execute( const std::string &input, const std::string &output ) {
+        using external_detail::error;
+        using run = typename external_detail::loser_tree<Record>::run;
+
+        external_detail::file in( ::open( input.c_str(), O_RDONLY | O_CLOEXEC ) );
+        if ( in.fd < 0 ) {
+            throw error( "open " + input );
+        }
+        struct stat st;
+        if ( ::fstat( in.fd, &st ) != 0 ) {
+            throw error( "stat " + input );
+        }
+        std::size_t bytes = static_cast<std::size_t>( st.st_size );
+        if ( bytes % sizeof( Record ) != 0 ) {
+            throw std::invalid_argument( input + ": size is not a whole number of records" );
+        }
+        std::size_t total = bytes / sizeof( Record );
+
+        external_detail::mapping source;
+        source.map( in.fd, bytes, input );
+        const Record *records = static_cast<const Record *>( source.addr );
+
+        std::vector<Record> buffer( std::min( total, chunk_records ) );
+        std::vector<std::pair<std::size_t, std::size_t>> spans; // offset, count
+        external_detail::file spill;
+        for ( std::size_t done = 0; done < total; ) {
+            std::size_t count = std::min( chunk_records, total - done );
+            std::memcpy( static_cast<void *>( buffer.data() ), records + done, count * sizeof( Record ) );
+            std::vector<std::pair<std::size_t, std::size_t>> pieces = sort_pieces( buffer.data(), count );
+
+            if ( total <= chunk_records ) {
+                spans = std::move( pieces ); // runs stay in buffer
+            } else {
+                if ( spill.fd < 0 ) {
+                    spill.fd = open_temp();
+                }
+                write_all( spill.fd, buffer.data(), count * sizeof( Record ), "spill file" );
+                for ( auto &piece : pieces ) {
+                    spans.emplace_back( done + piece.first, piece.second );
+                }
+            }
+            done += count;
+            source.release_before( done * sizeof( Record ) );
+        }
+        source.reset();
+        in.reset();
+
+        external_detail::mapping runs_map;
+        const Record *base = buffer.data();
+        if ( spill.fd >= 0 ) {
+            runs_map.map( spill.fd, total * sizeof( Record ), "spill file" );
+            base = static_cast<const Record *>( runs_map.addr );
+            std::vector<Record>().swap( buffer );
+        }
+        std::vector<run> runs;
+        for ( auto &span : spans ) {
+            runs.push_back( run{ base + span.first, base + span.first + span.second } );
+        }
+        last_runs = runs.size();
+
+        external_detail::file out(
+            ::open( output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 ) );
+        if ( out.fd < 0 ) {
+            throw error( "open " + output );
+        }
+        merge( std::move( runs ), out.fd, output );
+    }
+
+    // Sorted runs merged by the last execute.
+    std::size_t runs() const { return last_runs; }
+
+private:
+    static constexpr std::size_t min_piece  = std::size_t( 1 ) << 16; // records per parallel sort
+    static constexpr std::size_t io_records = std::max<std::size_t>( 1, ( std::size_t( 1 ) << 20 ) / sizeof( Record ) );
+
+    std::size_t chunk_records;
+    std::string temp_dir;
+    WorkStealingPool &pool;
+    std::size_t last_runs = 0;
+
+    static void write_all( int fd, const void *data, std::size_t size, const std::string &what ) {
+        external_detail::write_all( fd, data, size, what );
+    }
+
+    // Created and unlinked at once, so the space goes back to the file
+    // system whatever way the sort ends.
+    int open_temp() const {
+        std::string path = temp_dir + "/extsort.XXXXXX";
+        int fd           = ::mkstemp( &path[0] );
+        if ( fd < 0 ) {
+            throw external_detail::error( "mkstemp " + path );
+        }
+        ::unlink( path.c_str() );
+        return fd;
+    }
+
+    // Sorts [data, data + count) as up to one piece per worker; returns
+    // each piece as (offset, count).
+    std::vector<std::pair<std::size_t, std::size_t>> sort_pieces( Record *data, std::size_t count ) {
+        std::size_t n = std::max<std::size_t>( 1, std::min( pool.size(), count / min_piece ) );
+        std::vector<std::pair<std::size_t, std::size_t>> pieces;
+        for ( std::size_t i = 0; i < n; ++i ) {
+            std::size_t begin = count * i / n, end = count * ( i + 1 ) / n;
+            pieces.emplace_back( begin, end - begin );
+        }
+        auto sort_piece = [data, &pieces]( std::size_t i ) {
+            Record *first = data + pieces[i].first;
+            RunStrategy().execute( first, first + pieces[i].second );
+        };
+        ForkJoin( pool, n, sort_piece );
+        return pieces;
+    }
+
+    void merge( std::vector<typename external_detail::loser_tree<Record>::run> runs, int fd,
+        const std::string &what ) {
+        external_detail::loser_tree<Record> tree( std::move( runs ) );
+        std::vector<Record> block( io_records );
+        std::size_t used = 0;
+        while ( !tree.empty() ) {
+            block[used++] = tree.top();
+            tree.pop();
+            if ( used == block.size() ) {
+                write_all( fd, block.data(), used * sizeof( Record ), what );
+                used = 0;
+            }
+        }
+        write_all( fd, block.data(), used * sizeof( Record ), what );
+    }
+};
+
+} // namespace strategy
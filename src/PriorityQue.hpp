@@ -0,0 +1,162 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <utility>
+#include "ThreadSafeQue.hpp"
+
+// Mailbox with Lanes independent FIFO lanes built from ThreadSafeQue. Lane
+// 0 is the most urgent; consumers always drain lower-numbered lanes first,
+// so control messages overtake bulk data already queued behind them.
+// Ordering is FIFO within a lane only. Plain push/emplace go to the last
+// (least urgent) lane, so an actor can switch to this mailbox without
+// touching its existing senders.
+template <typename T, std::size_t Lanes = 2> class PriorityQue {
+    static_assert( Lanes > 0, "PriorityQue needs at least one lane" );
+
+public:
+    static constexpr std::size_t lane_count   = Lanes;
+    static constexpr std::size_t default_lane = Lanes - 1;
+
+    PriorityQue() = default;
+
+    PriorityQue( const PriorityQue & )            = delete;
+    PriorityQue &operator=( const PriorityQue & ) = delete;
+
+    void NotifyStop() {
+        bstop.store( true );
+        for ( auto &lane : lanes ) {
+            lane.NotifyStop();
+        }
+        parker.wake_all();
+    }
+
+    void SetWaitPolicy( const WaitPolicy &policy ) { parker.set_policy( policy ); }
+
+    bool empty() {
+        for ( auto &lane : lanes ) {
+            if ( !lane.empty() ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // lane is clamped to the least urgent one when out of range.
+    template <typename... Args> void EmplaceLane( std::size_t lane, Args &&...args ) {
+        lanes[lane < Lanes ? lane : default_lane].emplace( std::forward<Args>( args )... );
+        published( 1 );
+    }
+
+    void push( T new_value ) { emplace( std::move( new_value ) ); }
+
+    template <typename... Args> void emplace( Args &&...args ) {
+        EmplaceLane( default_lane, std::forward<Args>( args )... );
+    }
+
+    template <typename... Args> bool TryEmplace( Args &&...args ) {
+        emplace( std::forward<Args>( args )... );
+        return true;
+    }
+
+    bool TryPush( T new_value ) { return TryEmplace( std::move( new_value ) ); }
+
+    template <typename Range> std::size_t PushBulk( Range &&range ) {
+        std::size_t count = lanes[default_lane].PushBulk( std::forward<Range>( range ) );
+        if ( count > 0 ) {
+            published( count );
+        }
+        return count;
+    }
+
+    std::shared_ptr<T> WaitAndPop() {
+        std::shared_ptr<T> res;
+        for ( ;; ) {
+            if ( ( res = TryPop() ) || bstop.load() ) {
+                return res;
+            }
+            wait_for_data();
+        }
+    }
+
+    bool WaitAndPop( T &value ) {
+        for ( ;; ) {
+            if ( TryPop( value ) ) {
+                return true;
+            }
+            if ( bstop.load() ) {
+                return false;
+            }
+            wait_for_data();
+        }
+    }
+
+    std::shared_ptr<T> TryPop() {
+        for ( auto &lane : lanes ) {
+            if ( auto res = lane.TryPop() ) {
+                queued.fetch_sub( 1 );
+                return res;
+            }
+        }
+        return nullptr;
+    }
+
+    bool TryPop( T &value ) {
+        for ( auto &lane : lanes ) {
+            if ( lane.TryPop( value ) ) {
+                queued.fetch_sub( 1 );
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Takes up to max messages, most urgent lane first.
+    template <typename Container>
+    std::size_t DrainTo( Container &out, std::size_t max ) {
+        std::size_t count = 0;
+        for ( auto &lane : lanes ) {
+            if ( count == max ) {
+                break;
+            }
+            count += lane.DrainTo( out, max - count );
+        }
+        if ( count > 0 ) {
+            queued.fetch_sub( static_cast<std::ptrdiff_t>( count ) );
+        }
+        return count;
+    }
+
+    template <typename Container>
+    std::size_t WaitAndDrain( Container &out, std::size_t max ) {
+        for ( ;; ) {
+            std::size_t count = DrainTo( out, max );
+            if ( count > 0 || bstop.load() ) {
+                return count;
+            }
+            wait_for_data();
+        }
+    }
+
+private:
+    std::array<ThreadSafeQue<T>, Lanes> lanes;
+    // Messages across all lanes. It is bumped after the lane push, so it
+    // can briefly go negative; it only gates parking, never popping.
+    std::atomic<std::ptrdiff_t> queued{ 0 };
+    std::atomic<bool> bstop{ false };
+    QueParker parker;
+
+    void published( std::size_t count ) {
+        queued.fetch_add( static_cast<std::ptrdiff_t>( count ) );
+        parker.wake( count );
+    }
+
+    void wait_for_data() {
+        auto ready = [this] { return bstop.load() || queued.load() > 0; };
+        if ( !parker.spin( ready ) ) {
+            parker.park( ready );
+        }
+    }
+};
@@ -1,6 +1,6 @@
 #pragma once
 #include <memory>
-#include <iostream>
+#include "AsyncLog.hpp"
 
 namespace prototype {
 
@@ -21,7 +21,7 @@ public:
     std::unique_ptr<Shape>clone() const override { return std::make_unique<Circle>(this->radius); }
 
     void draw() const override {
-        std::cout << "Drawing a circle with radius " << radius << std::endl;
+        LogInfo( "Drawing a circle with radius ", radius );
     }
 
 private:
@@ -36,7 +36,7 @@ public:
     }
 
     void draw() const override {
-        std::cout << "Drawing a rectangle with width " << width << " and height " << height << std::endl;
+        LogInfo( "Drawing a rectangle with width ", width, " and height ", height );
     }
 private:
     double width, height;
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <type_traits>
+#include "QueParker.hpp"
+
+// Mailbox operations shared by the queues, written once over each queue's
+// own primitives. Derived befriends this base and provides
+//
+//   bstop, parker                          stop flag and consumer parker
+//   bool try_emplace( Args &&... )         never waits; consumes its
+//                                          arguments only on success
+//   bool try_consume( Func && )            hands one message to func
+//   void wait_for_data()                   spins/parks until data or stop
+//
+// and may hide any operation below with a version that batches under its
+// own lock (consume_batch, emplace, PushBulk, ...).
+template <typename Derived, typename T> class QueOps {
+public:
+    void SetWaitPolicy( const WaitPolicy &policy ) { self().parker.set_policy( policy ); }
+
+    void NotifyStop() {
+        self().bstop.store( true );
+        self().parker.wake_all();
+    }
+
+    // The shared_ptr overloads allocate a copy of the payload on pop; the
+    // by-value overloads move straight out of the queue.
+    std::shared_ptr<T> WaitAndPop() {
+        std::shared_ptr<T> res;
+        wait_consume(
+            [&res]( T &&value ) { res = std::make_shared<T>( std::move( value ) ); } );
+        return res;
+    }
+
+    bool WaitAndPop( T &value ) {
+        return wait_consume( [&value]( T &&v ) { value = std::move( v ); } );
+    }
+
+    std::shared_ptr<T> TryPop() {
+        std::shared_ptr<T> res;
+        self().try_consume(
+            [&res]( T &&value ) { res = std::make_shared<T>( std::move( value ) ); } );
+        return res;
+    }
+
+    bool TryPop( T &value ) {
+        return self().try_consume( [&value]( T &&v ) { value = std::move( v ); } );
+    }
+
+    bool TryPush( T new_value ) { return self().TryEmplace( std::move( new_value ) ); }
+
+    // Fails instead of waiting when the queue is full.
+    template <typename... Args> bool TryEmplace( Args &&...args ) {
+        if ( !self().try_emplace( std::forward<Args>( args )... ) ) {
+            return false;
+        }
+        self().parker.wake( 1 );
+        return true;
+    }
+
+    void push( T new_value ) { self().emplace( std::move( new_value ) ); }
+
+    // Yields until a slot frees up; the value is dropped once the queue has
+    // been stopped, since no consumer will ever make room again. The
+    // consumer itself must not push into its full queue: nobody else frees
+    // the slot, so it would yield until the queue is stopped.
+    template <typename... Args> void emplace( Args &&...args ) {
+        if ( push_or_drop( std::forward<Args>( args )... ) ) {
+            self().parker.wake( 1 );
+        }
+    }
+
+    // Claims a slot per element but wakes parked consumers only once, or
+    // early if the queue fills up and the rest of the batch has to wait.
+    // Elements are moved when the range is passed as an rvalue.
+    template <typename Range> std::size_t PushBulk( Range &&range ) {
+        std::size_t count = 0, pending = 0;
+        for ( auto &&elm : range ) {
+            bool pushed;
+            if constexpr ( std::is_lvalue_reference_v<Range> ) {
+                pushed = push_batched( elm, pending );
+            } else {
+                pushed = push_batched( std::move( elm ), pending );
+            }
+            if ( !pushed ) {
+                break;
+            }
+            ++count;
+        }
+        if ( pending > 0 ) {
+            self().parker.wake( pending );
+        }
+        return count;
+    }
+
+    // Moves up to max queued messages into out without blocking. out may
+    // hold either T or std::shared_ptr<T>.
+    template <typename Container>
+    std::size_t DrainTo( Container &out, std::size_t max ) {
+        return self().consume_batch( max, appender( out ) );
+    }
+
+    // Blocks until at least one message is queued, then behaves like
+    // DrainTo. Returns 0 once the queue has been stopped.
+    template <typename Container>
+    std::size_t WaitAndDrain( Container &out, std::size_t max ) {
+        if ( max == 0 ) {
+            return 0;
+        }
+        for ( ;; ) {
+            std::size_t count = DrainTo( out, max );
+            if ( count > 0 || self().bstop.load() ) {
+                return count;
+            }
+            self().wait_for_data();
+        }
+    }
+
+protected:
+    Derived &self() { return static_cast<Derived &>( *this ); }
+
+    template <typename Func> bool wait_consume( Func &&func ) {
+        for ( ;; ) {
+            if ( self().try_consume( func ) ) {
+                return true;
+            }
+            if ( self().bstop.load() ) {
+                return false;
+            }
+            self().wait_for_data();
+        }
+    }
+
+    template <typename Func> std::size_t consume_batch( std::size_t max, Func &&func ) {
+        std::size_t count = 0;
+        while ( count < max && self().try_consume( func ) ) {
+            ++count;
+        }
+        return count;
+    }
+
+    template <typename Container> static auto appender( Container &out ) {
+        return [&out]( T &&value ) {
+            using value_type = typename Container::value_type;
+            if constexpr ( std::is_same_v<value_type, std::shared_ptr<T>> ) {
+                out.push_back( std::make_shared<T>( std::move( value ) ) );
+            } else {
+                out.push_back( std::move( value ) );
+            }
+        };
+    }
+
+    // Retrying is safe: try_emplace only consumes its arguments on success.
+    template <typename... Args> bool push_or_drop( Args &&...args ) {
+        while ( !self().try_emplace( std::forward<Args>( args )... ) ) {
+            if ( self().bstop.load() ) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    // pending counts pushes not yet announced to the parker; they are
+    // announced before waiting for room, so a parked consumer can free it.
+    template <typename U>
+    bool push_batched( U &&value, std::size_t &pending ) {
+        if ( !self().try_emplace( std::forward<U>( value ) ) ) {
+            if ( pending > 0 ) {
+                self().parker.wake( pending );
+                pending = 0;
+            }
+            if ( !push_or_drop( std::forward<U>( value ) ) ) {
+                return false;
+            }
+        }
+        ++pending;
+        return true;
+    }
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <condition_variable>
+#if defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 )
+#include <immintrin.h>
+#endif
+
+inline void CpuRelax() {
+#if defined( __x86_64__ ) || defined( __i386__ ) || defined( _M_X64 )
+    _mm_pause();
+#elif defined( __aarch64__ )
+    asm volatile( "yield" );
+#endif
+}
+
+// How an idle consumer waits: busy-spin with a pause instruction for up to
+// max_spins polls, then std::this_thread::yield up to max_yields times, and
+// only then park on the condition variable. The default parks straight
+// away, which is the cheapest on CPU for actors that are mostly idle.
+struct WaitPolicy {
+    std::uint32_t max_spins  = 0;
+    std::uint32_t max_yields = 0;
+
+    static WaitPolicy Park() { return {}; }
+    static WaitPolicy LowLatency() { return { 4096, 64 }; }
+};
+
+// Blocking fallback for the queues. Consumers only take the mutex once
+// they have nothing left to pop, and producers only take it (and only
+// notify) when somebody is actually parked.
+class QueParker {
+public:
+    // Not synchronized with waiting consumers: set it before they start.
+    void set_policy( const WaitPolicy &new_policy ) {
+        policy = new_policy;
+        spin_budget.store( new_policy.max_spins, std::memory_order_relaxed );
+    }
+
+    // Polls ready through the spin and yield phases. The spin budget adapts:
+    // it grows while spinning keeps catching data and halves when a wait
+    // ends up parking anyway, so a mostly idle consumer stops burning CPU.
+    template <typename Pred> bool spin( Pred &&ready ) {
+        std::uint32_t budget = spin_budget.load( std::memory_order_relaxed );
+        for ( std::uint32_t i = 0; i < budget; ++i ) {
+            if ( ready() ) {
+                spin_budget.store( std::min( policy.max_spins, budget + budget / 4 + 1 ),
+                    std::memory_order_relaxed );
+                return true;
+            }
+            CpuRelax();
+        }
+        for ( std::uint32_t i = 0; i < policy.max_yields; ++i ) {
+            if ( ready() ) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+        spin_budget.store( std::max( std::min( policy.max_spins, min_spins ), budget / 2 ),
+            std::memory_order_relaxed );
+        return false;
+    }
+
+    // ready is re-checked under the mutex after the sleeper count has been
+    // published, so a concurrent wake() cannot be missed.
+    template <typename Pred> void park( Pred &&ready ) {
+        std::unique_lock<std::mutex> lock( park_mutex );
+        sleepers.fetch_add( 1 );
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        data_cond.wait( lock, ready );
+        sleepers.fetch_sub( 1 );
+    }
+
+    // Like park, but gives up at deadline; returns ready().
+    template <typename Pred, typename Clock, typename Duration>
+    bool park_until( Pred &&ready, const std::chrono::time_point<Clock, Duration> &deadline ) {
+        std::unique_lock<std::mutex> lock( park_mutex );
+        sleepers.fetch_add( 1 );
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        bool result = data_cond.wait_until( lock, deadline, ready );
+        sleepers.fetch_sub( 1 );
+        return result;
+    }
+
+    // Call after publishing new data.
+    void wake( std::size_t count ) {
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        if ( sleepers.load( std::memory_order_relaxed ) > 0 ) {
+            { std::lock_guard<std::mutex> lock( park_mutex ); }
+            if ( count == 1 ) {
+                data_cond.notify_one();
+            } else {
+                data_cond.notify_all();
+            }
+        }
+    }
+
+    // Wakes every parked thread, but only if there is one. For sleepers
+    // that wait on different predicates, where notify_one could pick the
+    // wrong thread.
+    void wake_sleepers() {
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        if ( sleepers.load( std::memory_order_relaxed ) > 0 ) {
+            { std::lock_guard<std::mutex> lock( park_mutex ); }
+            data_cond.notify_all();
+        }
+    }
+
+    void wake_all() {
+        { std::lock_guard<std::mutex> lock( park_mutex ); }
+        data_cond.notify_all();
+    }
+
+private:
+    static constexpr std::uint32_t min_spins = 64;
+
+    WaitPolicy policy;
+    std::atomic<std::uint32_t> spin_budget{ 0 };
+    alignas( 64 ) std::atomic<int> sleepers{ 0 };
+    std::mutex park_mutex;
+    std::condition_variable data_cond;
+};
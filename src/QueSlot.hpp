@@ -0,0 +1,22 @@
+#pragma once
+
+#include <new>
+#include <utility>
+#include <type_traits>
+
+// Builds a T from emplace arguments, using brace initialization when T has
+// no matching constructor so aggregates such as MsgClassA can be emplaced.
+// Returned as a prvalue, so the result is constructed straight into its
+// destination.
+template <typename T, typename... Args> T make_msg( Args &&...args ) {
+    if constexpr ( std::is_constructible_v<T, Args &&...> ) {
+        return T( std::forward<Args>( args )... );
+    } else {
+        return T{ std::forward<Args>( args )... };
+    }
+}
+
+template <typename T, typename... Args>
+T *construct_slot( void *storage, Args &&...args ) {
+    return ::new ( storage ) T( make_msg<T>( std::forward<Args>( args )... ) );
+}
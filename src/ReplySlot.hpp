@@ -0,0 +1,313 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <optional>
+#include "QueParker.hpp"
+#include "QueSlot.hpp"
+
+template <typename R> class ReplyPool;
+
+namespace reply_detail {
+
+enum : std::uint32_t { pending, ready, broken };
+
+// Shared by one Reply and one ReplyFuture; goes back to its pool when
+// both have let go.
+template <typename R> struct slot {
+    alignas( R ) unsigned char storage[sizeof( R )];
+    std::atomic<std::uint32_t> state{ pending };
+    std::atomic<std::uint32_t> refs{ 0 };
+    bool has_value = false;
+    slot *next_free = nullptr;
+    ReplyPool<R> *pool = nullptr; // owner, set once when the chunk is made
+
+    R *value() { return std::launder( reinterpret_cast<R *>( storage ) ); }
+};
+
+} // namespace reply_detail
+
+// Write end of an Ask, carried inside the request message as a member
+// named reply. The actor answers with Set; a Reply dropped unanswered (for
+// example with its message on StopWorker) breaks the future instead of
+// leaving the asker blocked.
+template <typename R> class Reply {
+public:
+    using value_type = R;
+
+    Reply() = default;
+
+    Reply( Reply &&other ) noexcept : cell( std::exchange( other.cell, nullptr ) ) {}
+
+    Reply &operator=( Reply &&other ) noexcept {
+        if ( this != &other ) {
+            finish( reply_detail::broken );
+            cell = std::exchange( other.cell, nullptr );
+        }
+        return *this;
+    }
+
+    ~Reply() { finish( reply_detail::broken ); }
+
+    explicit operator bool() const { return cell != nullptr; }
+
+    template <typename... Args> void Set( Args &&...args ) {
+        if ( !cell ) {
+            return;
+        }
+        construct_slot<R>( cell->storage, std::forward<Args>( args )... );
+        cell->has_value = true;
+        finish( reply_detail::ready );
+    }
+
+private:
+    friend class ReplyPool<R>;
+
+    reply_detail::slot<R> *cell = nullptr;
+
+    void finish( std::uint32_t state );
+};
+
+// Read end of an Ask. Move-only; waiting spins briefly, then parks on the
+// pool's parker.
+template <typename R> class ReplyFuture {
+public:
+    using value_type = R;
+
+    ReplyFuture() = default;
+
+    ReplyFuture( ReplyFuture &&other ) noexcept
+        : cell( std::exchange( other.cell, nullptr ) ) {}
+
+    ReplyFuture &operator=( ReplyFuture &&other ) noexcept {
+        if ( this != &other ) {
+            release();
+            cell = std::exchange( other.cell, nullptr );
+        }
+        return *this;
+    }
+
+    ~ReplyFuture() { release(); }
+
+    bool Valid() const { return cell != nullptr; }
+
+    // True once the reply was set or can no longer arrive.
+    bool Ready() const {
+        return !cell || cell->state.load( std::memory_order_acquire ) != reply_detail::pending;
+    }
+
+    void Wait() const;
+
+    // False on timeout.
+    template <typename Rep, typename Period>
+    bool WaitFor( std::chrono::duration<Rep, Period> timeout ) const;
+
+    // Waits, then moves the reply out; empty if the request was dropped or
+    // the value was already taken.
+    std::optional<R> Get() {
+        Wait();
+        if ( !cell || !cell->has_value ) {
+            return std::nullopt;
+        }
+        std::optional<R> res( std::move( *cell->value() ) );
+        cell->value()->~R();
+        cell->has_value = false;
+        return res;
+    }
+
+private:
+    friend class ReplyPool<R>;
+    template <typename Range> friend void WaitAll( Range &futures );
+    template <typename Range, typename Rep, typename Period>
+    friend bool WaitAllFor( Range &futures, std::chrono::duration<Rep, Period> timeout );
+
+    reply_detail::slot<R> *cell = nullptr;
+
+    void release();
+    QueParker &parker() const;
+};
+
+// Slab of reply slots for one reply type. Slots are allocated in chunks,
+// recycled through a free list and never returned to the heap, so an Ask
+// costs no allocation once the pool has grown to the number of requests
+// in flight. Each slot remembers its pool, so a pool other than Default
+// works too, but it must outlive every Reply and ReplyFuture it bound.
+template <typename R> class ReplyPool {
+public:
+    explicit ReplyPool( std::size_t initial = 64 ) {
+        parker.set_policy( WaitPolicy::LowLatency() );
+        std::lock_guard<std::mutex> lock( mutex );
+        grow( initial );
+    }
+
+    ReplyPool( const ReplyPool & )            = delete;
+    ReplyPool &operator=( const ReplyPool & ) = delete;
+
+    // Deliberately leaked: replies may still sit in actor mailboxes while
+    // static destructors run.
+    static ReplyPool &Default() {
+        static ReplyPool *pool = new ReplyPool;
+        return *pool;
+    }
+
+    // Not synchronized with waiters; set it before asking.
+    void SetWaitPolicy( const WaitPolicy &policy ) { parker.set_policy( policy ); }
+
+    // Arms reply (dropping whatever it was bound to) and returns the future
+    // that observes it.
+    ReplyFuture<R> Bind( Reply<R> &reply ) {
+        reply_detail::slot<R> *cell;
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            if ( !free_head ) {
+                grow( chunks.empty() ? 64 : chunk_sizes.back() * 2 );
+            }
+            cell      = free_head;
+            free_head = cell->next_free;
+        }
+        cell->state.store( reply_detail::pending, std::memory_order_relaxed );
+        cell->refs.store( 2, std::memory_order_relaxed );
+        cell->has_value = false;
+        reply           = Reply<R>();
+        reply.cell      = cell;
+        ReplyFuture<R> future;
+        future.cell = cell;
+        return future;
+    }
+
+private:
+    friend class Reply<R>;
+    friend class ReplyFuture<R>;
+
+    std::mutex mutex;
+    reply_detail::slot<R> *free_head = nullptr;
+    std::vector<std::unique_ptr<reply_detail::slot<R>[]>> chunks;
+    std::vector<std::size_t> chunk_sizes;
+    QueParker parker;
+
+    // Caller holds mutex.
+    void grow( std::size_t count ) {
+        chunks.emplace_back( new reply_detail::slot<R>[count] );
+        chunk_sizes.push_back( count );
+        reply_detail::slot<R> *chunk = chunks.back().get();
+        for ( std::size_t i = 0; i < count; ++i ) {
+            chunk[i].pool      = this;
+            chunk[i].next_free = free_head;
+            free_head          = &chunk[i];
+        }
+    }
+
+    void release( reply_detail::slot<R> *cell ) {
+        if ( cell->refs.fetch_sub( 1, std::memory_order_acq_rel ) != 1 ) {
+            return;
+        }
+        if ( cell->has_value ) {
+            cell->value()->~R();
+            cell->has_value = false;
+        }
+        std::lock_guard<std::mutex> lock( mutex );
+        cell->next_free = free_head;
+        free_head       = cell;
+    }
+};
+
+template <typename R> void Reply<R>::finish( std::uint32_t state ) {
+    if ( !cell ) {
+        return;
+    }
+    ReplyPool<R> &pool = *cell->pool;
+    cell->state.store( state, std::memory_order_release );
+    pool.parker.wake_sleepers();
+    pool.release( std::exchange( cell, nullptr ) );
+}
+
+template <typename R> void ReplyFuture<R>::release() {
+    if ( cell ) {
+        cell->pool->release( std::exchange( cell, nullptr ) );
+    }
+}
+
+template <typename R> QueParker &ReplyFuture<R>::parker() const {
+    return cell->pool->parker;
+}
+
+template <typename R> void ReplyFuture<R>::Wait() const {
+    if ( Ready() ) {
+        return;
+    }
+    QueParker &parker = this->parker();
+    auto ready        = [this] { return Ready(); };
+    if ( !parker.spin( ready ) ) {
+        parker.park( ready );
+    }
+}
+
+template <typename R>
+template <typename Rep, typename Period>
+bool ReplyFuture<R>::WaitFor( std::chrono::duration<Rep, Period> timeout ) const {
+    if ( Ready() ) {
+        return true;
+    }
+    auto deadline     = std::chrono::steady_clock::now() + timeout;
+    QueParker &parker = this->parker();
+    auto ready        = [this] { return Ready(); };
+    return parker.spin( ready ) || parker.park_until( ready, deadline );
+}
+
+// Blocks until every future in the range is ready, parking once per
+// wake-up rather than once per future. Futures from different pools are
+// waited for a run at a time, each run on its own pool's parker.
+template <typename Range> void WaitAll( Range &futures ) {
+    auto it  = std::begin( futures );
+    auto end = std::end( futures );
+    for ( ;; ) {
+        while ( it != end && it->Ready() ) {
+            ++it;
+        }
+        if ( it == end ) {
+            return;
+        }
+        QueParker &parker = it->parker();
+        auto run_ready    = [&it, end, &parker] {
+            while ( it != end && it->Ready() ) {
+                ++it;
+            }
+            return it == end || &it->parker() != &parker;
+        };
+        if ( !parker.spin( run_ready ) ) {
+            parker.park( run_ready );
+        }
+    }
+}
+
+// False on timeout.
+template <typename Range, typename Rep, typename Period>
+bool WaitAllFor( Range &futures, std::chrono::duration<Rep, Period> timeout ) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    auto it       = std::begin( futures );
+    auto end      = std::end( futures );
+    for ( ;; ) {
+        while ( it != end && it->Ready() ) {
+            ++it;
+        }
+        if ( it == end ) {
+            return true;
+        }
+        QueParker &parker = it->parker();
+        auto run_ready    = [&it, end, &parker] {
+            while ( it != end && it->Ready() ) {
+                ++it;
+            }
+            return it == end || &it->parker() != &parker;
+        };
+        if ( !parker.spin( run_ready ) && !parker.park_until( run_ready, deadline ) ) {
+            return false;
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include "QueOps.hpp"
+#include "QueParker.hpp"
+#include "QueSlot.hpp"
+
+// Bounded lock-free MPMC queue (Vyukov sequence-numbered ring). Slots are
+// allocated once up front, so push/pop never touch the heap. Consumers park
+// on a QueParker only when the ring is empty.
+template <typename T> class RingBufferQue : public QueOps<RingBufferQue<T>, T> {
+private:
+    friend class QueOps<RingBufferQue<T>, T>;
+
+    struct cell {
+        std::atomic<std::size_t> seq;
+        alignas( T ) unsigned char storage[sizeof( T )];
+
+        T *value() { return std::launder( reinterpret_cast<T *>( storage ) ); }
+    };
+
+    static constexpr std::size_t cache_line = 64;
+
+    static std::size_t round_capacity( std::size_t capacity ) {
+        std::size_t result = 2;
+        while ( result < capacity ) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const std::size_t mask;
+    std::unique_ptr<cell[]> buffer;
+    alignas( cache_line ) std::atomic<std::size_t> enqueue_pos{ 0 };
+    alignas( cache_line ) std::atomic<std::size_t> dequeue_pos{ 0 };
+    QueParker parker;
+    std::atomic<bool> bstop{ false };
+
+    bool ready() {
+        std::size_t pos = dequeue_pos.load( std::memory_order_relaxed );
+        cell &c         = buffer[pos & mask];
+        return c.seq.load( std::memory_order_acquire ) == pos + 1;
+    }
+
+    template <typename... Args> bool try_emplace( Args &&...args ) {
+        std::size_t pos = enqueue_pos.load( std::memory_order_relaxed );
+        for ( ;; ) {
+            cell &c         = buffer[pos & mask];
+            std::size_t seq = c.seq.load( std::memory_order_acquire );
+            auto diff       = static_cast<std::ptrdiff_t>( seq - pos );
+            if ( diff == 0 ) {
+                if ( enqueue_pos.compare_exchange_weak(
+                         pos, pos + 1, std::memory_order_relaxed ) ) {
+                    construct_slot<T>( c.storage, std::forward<Args>( args )... );
+                    c.seq.store( pos + 1, std::memory_order_release );
+                    return true;
+                }
+            } else if ( diff < 0 ) {
+                return false;
+            } else {
+                pos = enqueue_pos.load( std::memory_order_relaxed );
+            }
+        }
+    }
+
+    template <typename Func> bool try_consume( Func &&func ) {
+        std::size_t pos = dequeue_pos.load( std::memory_order_relaxed );
+        for ( ;; ) {
+            cell &c         = buffer[pos & mask];
+            std::size_t seq = c.seq.load( std::memory_order_acquire );
+            auto diff       = static_cast<std::ptrdiff_t>( seq - ( pos + 1 ) );
+            if ( diff == 0 ) {
+                if ( dequeue_pos.compare_exchange_weak(
+                         pos, pos + 1, std::memory_order_relaxed ) ) {
+                    T *value = c.value();
+                    func( std::move( *value ) );
+                    value->~T();
+                    c.seq.store( pos + mask + 1, std::memory_order_release );
+                    return true;
+                }
+            } else if ( diff < 0 ) {
+                return false;
+            } else {
+                pos = dequeue_pos.load( std::memory_order_relaxed );
+            }
+        }
+    }
+
+    // Spins or parks per the wait policy until data may be available.
+    void wait_for_data() {
+        auto wake = [this] { return bstop.load() || ready(); };
+        if ( !parker.spin( wake ) ) {
+            parker.park( wake );
+        }
+    }
+
+public:
+    explicit RingBufferQue( std::size_t capacity = 1024 )
+        : mask( round_capacity( capacity ) - 1 ),
+          buffer( new cell[mask + 1] ) {
+        for ( std::size_t i = 0; i <= mask; ++i ) {
+            buffer[i].seq.store( i, std::memory_order_relaxed );
+        }
+    }
+
+    ~RingBufferQue() {
+        while ( try_consume( []( T && ) {} ) ) {
+        }
+    }
+
+    RingBufferQue( const RingBufferQue & )            = delete;
+    RingBufferQue &operator=( const RingBufferQue & ) = delete;
+
+    std::size_t capacity() const { return mask + 1; }
+
+    bool empty() { return !ready(); }
+};
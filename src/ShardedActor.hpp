@@ -0,0 +1,105 @@
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include "CpuAffinity.hpp"
+
+enum class ShardPlacement {
+    Unpinned,
+    PerCpu,      // shard i on the i-th allowed CPU, wrapping around
+    PerNumaNode, // shard i on every CPU of node i % node count
+};
+
+// N instances of one actor class, for an actor too hot for a single core.
+// Messages are routed by a hash of a caller-supplied key, so messages for
+// one key always reach the same shard and keep their order; there is no
+// ordering across keys. Each shard is an ordinary ActorSingle-derived
+// class constructed as ShardType( index, affinity ), which passes the
+// affinity to StartThread:
+//
+//   class Counter : public ActorSingle<Counter, Hit> {
+//       friend class ShardGroup<Counter>;
+//       Counter( std::size_t, CpuSet cpus ) : ActorSingle( "Counter" ) {
+//           StartThread( std::move( cpus ) );
+//       }
+//       ...
+//   };
+//
+//   ShardGroup<Counter> counters( 8, ShardPlacement::PerCpu );
+//   counters.PostMsg( hit.user_id, hit );
+//
+// Shards are destroyed one after another, so they must not post to each
+// other.
+template <typename ShardType> class ShardGroup {
+public:
+    // count 0 means one shard per allowed CPU.
+    explicit ShardGroup( std::size_t count = 0,
+        ShardPlacement placement = ShardPlacement::Unpinned ) {
+        CpuSet allowed = CpuSet::Allowed();
+        if ( count == 0 ) {
+            count = std::max<std::size_t>( 1, allowed.empty()
+                                                  ? std::thread::hardware_concurrency()
+                                                  : allowed.cpus.size() );
+        }
+        int nodes = placement == ShardPlacement::PerNumaNode ? CpuSet::NumaNodeCount() : 1;
+        shards.reserve( count );
+        for ( std::size_t i = 0; i < count; ++i ) {
+            CpuSet affinity;
+            if ( placement == ShardPlacement::PerCpu && !allowed.empty() ) {
+                affinity = CpuSet::Cpu( allowed.cpus[i % allowed.cpus.size()] );
+            } else if ( placement == ShardPlacement::PerNumaNode ) {
+                affinity = CpuSet::NumaNode( static_cast<int>( i % nodes ) );
+            }
+            shards.emplace_back( new ShardType( i, std::move( affinity ) ) );
+        }
+    }
+
+    ShardGroup( const ShardGroup & )            = delete;
+    ShardGroup &operator=( const ShardGroup & ) = delete;
+
+    std::size_t size() const { return shards.size(); }
+
+    ShardType &Shard( std::size_t index ) { return *shards[index]; }
+
+    template <typename Key> std::size_t ShardOf( const Key &key ) const {
+        std::uint64_t h = std::hash<Key>{}( key );
+        // std::hash of an integer is usually the identity; mix it so keys
+        // with a common stride still spread over the shards.
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<std::size_t>( h % shards.size() );
+    }
+
+    template <typename Key, typename Msg> void PostMsg( const Key &key, Msg &&msg ) {
+        Shard( ShardOf( key ) ).PostMsg( std::forward<Msg>( msg ) );
+    }
+
+    template <typename Key, typename... Args> void EmplaceMsg( const Key &key, Args &&...args ) {
+        Shard( ShardOf( key ) ).EmplaceMsg( std::forward<Args>( args )... );
+    }
+
+    template <typename Key, typename Msg> bool TryPostMsg( const Key &key, Msg &&msg ) {
+        return Shard( ShardOf( key ) ).TryPostMsg( std::forward<Msg>( msg ) );
+    }
+
+    template <typename Key, typename Msg> auto Ask( const Key &key, Msg msg ) {
+        return Shard( ShardOf( key ) ).Ask( std::move( msg ) );
+    }
+
+    // Copies msg to every shard.
+    template <typename Msg> void Broadcast( const Msg &msg ) {
+        for ( auto &shard : shards ) {
+            shard->PostMsg( msg );
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<ShardType>> shards;
+};
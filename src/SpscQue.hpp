@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <cassert>
+#include <utility>
+#include <type_traits>
+#include "QueOps.hpp"
+#include "QueParker.hpp"
+#include "QueSlot.hpp"
+
+// Bounded single-producer/single-consumer ring for point-to-point actor
+// links. TryPush/TryPop are wait-free: each side owns one index, keeps a
+// cached copy of the other side's index on its own cache line and only
+// re-reads the shared one when the cache says full/empty. Exactly one
+// thread may push and one thread may pop. Debug builds bind the producer
+// side to the first thread that pushes and assert on pushes from any other.
+template <typename T> class SpscQue : public QueOps<SpscQue<T>, T> {
+private:
+    friend class QueOps<SpscQue<T>, T>;
+
+    struct slot {
+        alignas( T ) unsigned char storage[sizeof( T )];
+
+        T *value() { return std::launder( reinterpret_cast<T *>( storage ) ); }
+    };
+
+    static constexpr std::size_t cache_line = 64;
+
+    static std::size_t round_capacity( std::size_t capacity ) {
+        std::size_t result = 2;
+        while ( result < capacity ) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const std::size_t mask;
+    std::unique_ptr<slot[]> buffer;
+    // Consumer side.
+    alignas( cache_line ) std::atomic<std::size_t> head{ 0 };
+    std::size_t cached_tail = 0;
+    // Producer side.
+    alignas( cache_line ) std::atomic<std::size_t> tail{ 0 };
+    std::size_t cached_head = 0;
+    alignas( cache_line ) std::atomic<bool> bstop{ false };
+    QueParker parker;
+#ifndef NDEBUG
+    std::atomic<std::thread::id> producer{};
+
+    void check_producer() {
+        std::thread::id owner, self = std::this_thread::get_id();
+        if ( !producer.compare_exchange_strong( owner, self, std::memory_order_relaxed ) ) {
+            assert( owner == self && "SpscQue pushed from a second producer thread" );
+        }
+    }
+#endif
+
+    bool ready() {
+        return head.load( std::memory_order_relaxed ) !=
+               tail.load( std::memory_order_acquire );
+    }
+
+    template <typename... Args> bool try_emplace( Args &&...args ) {
+#ifndef NDEBUG
+        check_producer();
+#endif
+        std::size_t pos = tail.load( std::memory_order_relaxed );
+        if ( pos - cached_head > mask ) {
+            cached_head = head.load( std::memory_order_acquire );
+            if ( pos - cached_head > mask ) {
+                return false;
+            }
+        }
+        construct_slot<T>( buffer[pos & mask].storage, std::forward<Args>( args )... );
+        tail.store( pos + 1, std::memory_order_release );
+        return true;
+    }
+
+    template <typename Func> bool try_consume( Func &&func ) {
+        std::size_t pos = head.load( std::memory_order_relaxed );
+        if ( pos == cached_tail ) {
+            cached_tail = tail.load( std::memory_order_acquire );
+            if ( pos == cached_tail ) {
+                return false;
+            }
+        }
+        T *value = buffer[pos & mask].value();
+        func( std::move( *value ) );
+        value->~T();
+        head.store( pos + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Spins or parks per the wait policy until data may be available.
+    void wait_for_data() {
+        auto wake = [this] { return bstop.load() || ready(); };
+        if ( !parker.spin( wake ) ) {
+            parker.park( wake );
+        }
+    }
+
+public:
+    explicit SpscQue( std::size_t capacity = 1024 )
+        : mask( round_capacity( capacity ) - 1 ),
+          buffer( new slot[mask + 1] ) {}
+
+    ~SpscQue() {
+        while ( try_consume( []( T && ) {} ) ) {
+        }
+    }
+
+    SpscQue( const SpscQue & )            = delete;
+    SpscQue &operator=( const SpscQue & ) = delete;
+
+    std::size_t capacity() const { return mask + 1; }
+
+    bool empty() { return !ready(); }
+};
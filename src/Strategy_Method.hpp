@@ -5,6 +5,19 @@
 #include <algorithm>
 #include <vector>
 #include <iostream>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+#include <cstring>
+#include <limits>
+#include "WorkStealingPool.hpp"
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#elif defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
 
 namespace strategy {
 
@@ -18,14 +31,19 @@ template <typename Iterator>
 class Quick_Sorting : public SortingStrategy<Iterator> {
 public:
     virtual void execute( Iterator first, Iterator last ) override {
+        sort( first, last );
+    }
+
+private:
+    // Recursion stays out of the vtable.
+    void sort( Iterator first, Iterator last ) {
         if ( first >= last ) return;
 
         auto pivot = partition( first, last );
-        execute( first, pivot );
-        execute( std::next( pivot ), last );
+        sort( first, pivot );
+        sort( std::next( pivot ), last );
     }
 
-private:
     Iterator partition( Iterator first, Iterator last ) {
         auto pivot = *std::prev( last );
 
@@ -73,7 +91,1126 @@ public:
     }
 };
 
-template <typename Iterator> class SortContext {
+// Pdq_Sorting is an altered port of pdqsort by Orson Peters
+// (https://github.com/orlp/pdqsort), reshaped into a SortingStrategy;
+// the structure, constants and partition schemes follow pdqsort.h, which
+// is distributed under the zlib license below.
+//
+//   pdqsort.h - Pattern-defeating quicksort.
+//
+//   Copyright (c) 2021 Orson Peters
+//
+//   This software is provided 'as-is', without any express or implied
+//   warranty. In no event will the authors be held liable for any damages
+//   arising from the use of this software.
+//
+//   Permission is granted to anyone to use this software for any purpose,
+//   including commercial applications, and to alter it and redistribute it
+//   freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must not
+//      claim that you wrote the original software. If you use this software
+//      in a product, an acknowledgment in the product documentation would
+//      be appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must not
+//      be misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//      distribution.
+//
+// Pattern-defeating quicksort: O(n log n) worst case with no recursion
+// deeper than log n.
+// - Pivots: median of 3, or Tukey's ninther above ninther_limit.
+// - Small ranges use insertion sort.
+// - Runs equal to a previous pivot are split off in one pass, so inputs
+//   with few distinct keys sort in linear time.
+// - A partition that moved nothing is finished by a bounded insertion sort,
+//   which makes sorted and reversed inputs linear.
+// - Unbalanced partitions shuffle a few elements to break adversarial
+//   patterns; after log n of them the range falls back to heapsort.
+// - Arithmetic keys use the branchless block partition of BlockQuicksort,
+//   which avoids branch mispredictions on random data.
+template <typename Iterator>
+class Pdq_Sorting : public SortingStrategy<Iterator> {
+public:
+    using value_type = typename std::iterator_traits<Iterator>::value_type;
+
+    virtual void execute( Iterator first, Iterator last ) override {
+        diff_t size = last - first;
+        if ( size < 2 ) return;
+
+        int depth = 0;
+        while ( size >>= 1 ) {
+            ++depth;
+        }
+        sort_loop( first, last, depth, true );
+    }
+
+private:
+    using diff_t = typename std::iterator_traits<Iterator>::difference_type;
+
+    static constexpr diff_t insertion_limit         = 24;
+    static constexpr diff_t ninther_limit           = 128;
+    static constexpr diff_t partial_insertion_limit = 8;
+    static constexpr std::size_t block_size         = 64;
+    static constexpr bool branchless                = std::is_arithmetic<value_type>::value;
+
+    static void insertion_sort( Iterator first, Iterator last ) {
+        if ( first == last ) return;
+
+        for ( Iterator cur = first + 1; cur != last; ++cur ) {
+            Iterator sift   = cur;
+            Iterator sift_1 = cur - 1;
+            if ( *sift < *sift_1 ) {
+                value_type tmp( std::move( *sift ) );
+                do {
+                    *sift-- = std::move( *sift_1 );
+                } while ( sift != first && tmp < *--sift_1 );
+                *sift = std::move( tmp );
+            }
+        }
+    }
+
+    // Needs an element before first that is not greater than any in the
+    // range, which stops the inner loop without a bounds check.
+    static void unguarded_insertion_sort( Iterator first, Iterator last ) {
+        if ( first == last ) return;
+
+        for ( Iterator cur = first + 1; cur != last; ++cur ) {
+            Iterator sift   = cur;
+            Iterator sift_1 = cur - 1;
+            if ( *sift < *sift_1 ) {
+                value_type tmp( std::move( *sift ) );
+                do {
+                    *sift-- = std::move( *sift_1 );
+                } while ( tmp < *--sift_1 );
+                *sift = std::move( tmp );
+            }
+        }
+    }
+
+    // Insertion sort that gives up after partial_insertion_limit moves;
+    // returns whether the range ended up sorted.
+    static bool partial_insertion_sort( Iterator first, Iterator last ) {
+        if ( first == last ) return true;
+
+        diff_t moves = 0;
+        for ( Iterator cur = first + 1; cur != last; ++cur ) {
+            if ( moves > partial_insertion_limit ) return false;
+
+            Iterator sift   = cur;
+            Iterator sift_1 = cur - 1;
+            if ( *sift < *sift_1 ) {
+                value_type tmp( std::move( *sift ) );
+                do {
+                    *sift-- = std::move( *sift_1 );
+                } while ( sift != first && tmp < *--sift_1 );
+                *sift = std::move( tmp );
+                moves += cur - sift;
+            }
+        }
+        return true;
+    }
+
+    static void sort2( Iterator a, Iterator b ) {
+        if ( *b < *a ) std::iter_swap( a, b );
+    }
+
+    static void sort3( Iterator a, Iterator b, Iterator c ) {
+        sort2( a, b );
+        sort2( b, c );
+        sort2( a, b );
+    }
+
+    // Swaps the misplaced elements found by the branchless partition; a
+    // cyclic permutation needs fewer moves when the counts differ.
+    static void swap_offsets( Iterator first, Iterator last, const unsigned char *offsets_l,
+        const unsigned char *offsets_r, std::size_t num, bool use_swaps ) {
+        if ( use_swaps ) {
+            for ( std::size_t i = 0; i < num; ++i ) {
+                std::iter_swap( first + offsets_l[i], last - offsets_r[i] );
+            }
+        } else if ( num > 0 ) {
+            Iterator l = first + offsets_l[0];
+            Iterator r = last - offsets_r[0];
+            value_type tmp( std::move( *l ) );
+            *l = std::move( *r );
+            for ( std::size_t i = 1; i < num; ++i ) {
+                l  = first + offsets_l[i];
+                *r = std::move( *l );
+                r  = last - offsets_r[i];
+                *l = std::move( *r );
+            }
+            *r = std::move( tmp );
+        }
+    }
+
+    // Partitions around *begin, with elements equal to the pivot going to
+    // the right. Returns the pivot's final position and whether nothing had
+    // to move. The median-of-3 step guarantees a sentinel on both sides.
+    static std::pair<Iterator, bool> partition_right( Iterator begin, Iterator end ) {
+        value_type pivot( std::move( *begin ) );
+        Iterator first = begin;
+        Iterator last  = end;
+
+        while ( *++first < pivot ) {
+        }
+        if ( first - 1 == begin ) {
+            while ( first < last && !( *--last < pivot ) ) {
+            }
+        } else {
+            while ( !( *--last < pivot ) ) {
+            }
+        }
+
+        bool already_partitioned = first >= last;
+        while ( first < last ) {
+            std::iter_swap( first, last );
+            while ( *++first < pivot ) {
+            }
+            while ( !( *--last < pivot ) ) {
+            }
+        }
+
+        Iterator pivot_pos = first - 1;
+        *begin             = std::move( *pivot_pos );
+        *pivot_pos         = std::move( pivot );
+        return { pivot_pos, already_partitioned };
+    }
+
+    // Same contract as partition_right. Comparison results are collected
+    // as offsets of misplaced elements in blocks of block_size, then
+    // swapped in bulk, so the loop has no data-dependent branches.
+    static std::pair<Iterator, bool> partition_right_branchless( Iterator begin, Iterator end ) {
+        value_type pivot( std::move( *begin ) );
+        Iterator first = begin;
+        Iterator last  = end;
+
+        while ( *++first < pivot ) {
+        }
+        if ( first - 1 == begin ) {
+            while ( first < last && !( *--last < pivot ) ) {
+            }
+        } else {
+            while ( !( *--last < pivot ) ) {
+            }
+        }
+
+        bool already_partitioned = first >= last;
+        if ( !already_partitioned ) {
+            std::iter_swap( first, last );
+            ++first;
+
+            unsigned char buffer_l[block_size];
+            unsigned char buffer_r[block_size];
+            unsigned char *offsets_l = buffer_l;
+            unsigned char *offsets_r = buffer_r;
+            Iterator offsets_l_base  = first;
+            Iterator offsets_r_base  = last;
+            std::size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+            while ( first < last ) {
+                // Refill whichever side ran out, splitting the unknown part
+                // when both did.
+                std::size_t num_unknown = static_cast<std::size_t>( last - first );
+                std::size_t left_split =
+                    num_l == 0 ? ( num_r == 0 ? num_unknown / 2 : num_unknown ) : 0;
+                std::size_t right_split = num_r == 0 ? ( num_unknown - left_split ) : 0;
+
+                std::size_t left_count = std::min( left_split, block_size );
+                for ( std::size_t i = 0; i < left_count; ++i ) {
+                    offsets_l[num_l] = static_cast<unsigned char>( i );
+                    num_l += !( *first < pivot );
+                    ++first;
+                }
+                std::size_t right_count = std::min( right_split, block_size );
+                for ( std::size_t i = 0; i < right_count; ++i ) {
+                    offsets_r[num_r] = static_cast<unsigned char>( i + 1 );
+                    num_r += *--last < pivot;
+                }
+
+                std::size_t num = std::min( num_l, num_r );
+                swap_offsets( offsets_l_base, offsets_r_base, offsets_l + start_l,
+                    offsets_r + start_r, num, num_l == num_r );
+                num_l -= num;
+                num_r -= num;
+                start_l += num;
+                start_r += num;
+                if ( num_l == 0 ) {
+                    start_l        = 0;
+                    offsets_l_base = first;
+                }
+                if ( num_r == 0 ) {
+                    start_r        = 0;
+                    offsets_r_base = last;
+                }
+            }
+
+            // At most one side has leftovers; move them next to the pivot.
+            if ( num_l ) {
+                offsets_l += start_l;
+                while ( num_l-- ) {
+                    std::iter_swap( offsets_l_base + offsets_l[num_l], --last );
+                }
+                first = last;
+            }
+            if ( num_r ) {
+                offsets_r += start_r;
+                while ( num_r-- ) {
+                    std::iter_swap( offsets_r_base - offsets_r[num_r], first );
+                    ++first;
+                }
+                last = first;
+            }
+        }
+
+        Iterator pivot_pos = first - 1;
+        *begin             = std::move( *pivot_pos );
+        *pivot_pos         = std::move( pivot );
+        return { pivot_pos, already_partitioned };
+    }
+
+    // Partitions around *begin with elements equal to the pivot going to
+    // the left. Used when the pivot equals the element before the range,
+    // so the whole run of equal keys lands in place at once.
+    static Iterator partition_left( Iterator begin, Iterator end ) {
+        value_type pivot( std::move( *begin ) );
+        Iterator first = begin;
+        Iterator last  = end;
+
+        while ( pivot < *--last ) {
+        }
+        if ( last + 1 == end ) {
+            while ( first < last && !( pivot < *++first ) ) {
+            }
+        } else {
+            while ( !( pivot < *++first ) ) {
+            }
+        }
+
+        while ( first < last ) {
+            std::iter_swap( first, last );
+            while ( pivot < *--last ) {
+            }
+            while ( !( pivot < *++first ) ) {
+            }
+        }
+
+        Iterator pivot_pos = last;
+        *begin             = std::move( *pivot_pos );
+        *pivot_pos         = std::move( pivot );
+        return pivot_pos;
+    }
+
+    // bad_allowed counts the unbalanced partitions left before heapsort;
+    // leftmost is false when an element before begin bounds the range.
+    static void sort_loop( Iterator begin, Iterator end, int bad_allowed, bool leftmost ) {
+        for ( ;; ) {
+            diff_t size = end - begin;
+            if ( size < insertion_limit ) {
+                if ( leftmost ) {
+                    insertion_sort( begin, end );
+                } else {
+                    unguarded_insertion_sort( begin, end );
+                }
+                return;
+            }
+
+            // Pivot ends up in *begin.
+            diff_t s2 = size / 2;
+            if ( size > ninther_limit ) {
+                sort3( begin, begin + s2, end - 1 );
+                sort3( begin + 1, begin + ( s2 - 1 ), end - 2 );
+                sort3( begin + 2, begin + ( s2 + 1 ), end - 3 );
+                sort3( begin + ( s2 - 1 ), begin + s2, begin + ( s2 + 1 ) );
+                std::iter_swap( begin, begin + s2 );
+            } else {
+                sort3( begin + s2, begin, end - 1 );
+            }
+
+            if ( !leftmost && !( *( begin - 1 ) < *begin ) ) {
+                begin = partition_left( begin, end ) + 1;
+                continue;
+            }
+
+            std::pair<Iterator, bool> part = branchless
+                                                 ? partition_right_branchless( begin, end )
+                                                 : partition_right( begin, end );
+            Iterator pivot_pos       = part.first;
+            bool already_partitioned = part.second;
+
+            diff_t l_size = pivot_pos - begin;
+            diff_t r_size = end - ( pivot_pos + 1 );
+            if ( l_size < size / 8 || r_size < size / 8 ) {
+                if ( --bad_allowed == 0 ) {
+                    std::make_heap( begin, end );
+                    std::sort_heap( begin, end );
+                    return;
+                }
+
+                if ( l_size >= insertion_limit ) {
+                    std::iter_swap( begin, begin + l_size / 4 );
+                    std::iter_swap( pivot_pos - 1, pivot_pos - l_size / 4 );
+                    if ( l_size > ninther_limit ) {
+                        std::iter_swap( begin + 1, begin + ( l_size / 4 + 1 ) );
+                        std::iter_swap( begin + 2, begin + ( l_size / 4 + 2 ) );
+                        std::iter_swap( pivot_pos - 2, pivot_pos - ( l_size / 4 + 1 ) );
+                        std::iter_swap( pivot_pos - 3, pivot_pos - ( l_size / 4 + 2 ) );
+                    }
+                }
+                if ( r_size >= insertion_limit ) {
+                    std::iter_swap( pivot_pos + 1, pivot_pos + ( 1 + r_size / 4 ) );
+                    std::iter_swap( end - 1, end - r_size / 4 );
+                    if ( r_size > ninther_limit ) {
+                        std::iter_swap( pivot_pos + 2, pivot_pos + ( 2 + r_size / 4 ) );
+                        std::iter_swap( pivot_pos + 3, pivot_pos + ( 3 + r_size / 4 ) );
+                        std::iter_swap( end - 2, end - ( 1 + r_size / 4 ) );
+                        std::iter_swap( end - 3, end - ( 2 + r_size / 4 ) );
+                    }
+                }
+            } else if ( already_partitioned && partial_insertion_sort( begin, pivot_pos ) &&
+                        partial_insertion_sort( pivot_pos + 1, end ) ) {
+                return;
+            }
+
+            // Recurse into the smaller side and loop on the larger one.
+            if ( l_size < r_size ) {
+                sort_loop( begin, pivot_pos, bad_allowed, leftmost );
+                begin    = pivot_pos + 1;
+                leftmost = false;
+            } else {
+                sort_loop( pivot_pos + 1, end, bad_allowed, false );
+                end = pivot_pos;
+            }
+        }
+    }
+};
+
+namespace radix_detail {
+
+// Default key extractor: the value itself.
+struct identity {
+    template <typename T> const T &operator()( const T &value ) const { return value; }
+};
+
+template <typename Key>
+constexpr bool supported_key =
+    std::is_integral<Key>::value ||
+    ( std::is_floating_point<Key>::value && ( sizeof( Key ) == 4 || sizeof( Key ) == 8 ) );
+
+template <typename Key>
+using unsigned_key = std::conditional_t<sizeof( Key ) == 1, std::uint8_t,
+    std::conditional_t<sizeof( Key ) == 2, std::uint16_t,
+        std::conditional_t<sizeof( Key ) == 4, std::uint32_t, std::uint64_t>>>;
+
+// Maps a key to an unsigned integer with the same order. Signed integers
+// get their sign bit flipped; negative floats have all bits flipped and
+// non-negative ones only the sign bit, so the bit patterns sort like the
+// values (with -0.0 before +0.0 and NaNs at the ends).
+template <typename Key> unsigned_key<Key> to_unsigned( Key key ) {
+    using U                = unsigned_key<Key>;
+    constexpr unsigned top = sizeof( U ) * 8 - 1;
+    U bits;
+    std::memcpy( &bits, &key, sizeof( U ) );
+    if constexpr ( std::is_floating_point<Key>::value ) {
+        U mask = static_cast<U>( U( 0 ) - ( bits >> top ) ) | static_cast<U>( U( 1 ) << top );
+        return bits ^ mask;
+    } else if constexpr ( std::is_signed<Key>::value ) {
+        return bits ^ static_cast<U>( U( 1 ) << top );
+    } else {
+        return bits;
+    }
+}
+
+constexpr std::size_t network_size = 16;
+
+// Bitonic network step k/j on lanes base .. base + lanes - 1: which lanes
+// keep the larger value.
+constexpr int max_lanes( int k, int j, int lanes, int base = 0 ) {
+    int mask = 0;
+    for ( int i = 0; i < lanes; ++i ) {
+        int g = base + i;
+        if ( ( ( g & j ) != 0 ) == ( ( g & k ) == 0 ) ) mask |= 1 << i;
+    }
+    return mask;
+}
+
+#if defined( __AVX2__ )
+// Eight 32-bit lanes per register; the 16 values live in two registers.
+struct avx2_i32 {
+    using value = std::int32_t;
+    using reg   = __m256i;
+    static reg load( const value *p ) { return _mm256_loadu_si256( reinterpret_cast<const reg *>( p ) ); }
+    static void store( value *p, reg v ) { _mm256_storeu_si256( reinterpret_cast<reg *>( p ), v ); }
+    static reg min( reg a, reg b ) { return _mm256_min_epi32( a, b ); }
+    static reg max( reg a, reg b ) { return _mm256_max_epi32( a, b ); }
+    static reg permute( reg v, __m256i idx ) { return _mm256_permutevar8x32_epi32( v, idx ); }
+    template <int Mask> static reg blend( reg a, reg b ) { return _mm256_blend_epi32( a, b, Mask ); }
+};
+
+struct avx2_u32 : avx2_i32 {
+    using value = std::uint32_t;
+    static reg load( const value *p ) { return _mm256_loadu_si256( reinterpret_cast<const reg *>( p ) ); }
+    static void store( value *p, reg v ) { _mm256_storeu_si256( reinterpret_cast<reg *>( p ), v ); }
+    static reg min( reg a, reg b ) { return _mm256_min_epu32( a, b ); }
+    static reg max( reg a, reg b ) { return _mm256_max_epu32( a, b ); }
+};
+
+struct avx2_f32 {
+    using value = float;
+    using reg   = __m256;
+    static reg load( const value *p ) { return _mm256_loadu_ps( p ); }
+    static void store( value *p, reg v ) { _mm256_storeu_ps( p, v ); }
+    static reg min( reg a, reg b ) { return _mm256_min_ps( a, b ); }
+    static reg max( reg a, reg b ) { return _mm256_max_ps( a, b ); }
+    static reg permute( reg v, __m256i idx ) { return _mm256_permutevar8x32_ps( v, idx ); }
+    template <int Mask> static reg blend( reg a, reg b ) { return _mm256_blend_ps( a, b, Mask ); }
+};
+
+template <typename Ops, int K, int J> typename Ops::reg avx2_step( typename Ops::reg v ) {
+    const __m256i partner = _mm256_setr_epi32( 0 ^ J, 1 ^ J, 2 ^ J, 3 ^ J, 4 ^ J, 5 ^ J, 6 ^ J, 7 ^ J );
+    typename Ops::reg swapped = Ops::permute( v, partner );
+    return Ops::template blend<max_lanes( K, J, 8 )>(
+        Ops::min( v, swapped ), Ops::max( v, swapped ) );
+}
+
+// Bitonic sort of each register, then one merge across the pair.
+template <typename Ops> void avx2_network( typename Ops::value *v ) {
+    typename Ops::reg a = Ops::load( v );
+    typename Ops::reg b = Ops::load( v + 8 );
+    a = avx2_step<Ops, 2, 1>( a );
+    b = avx2_step<Ops, 2, 1>( b );
+    a = avx2_step<Ops, 4, 2>( a );
+    b = avx2_step<Ops, 4, 2>( b );
+    a = avx2_step<Ops, 4, 1>( a );
+    b = avx2_step<Ops, 4, 1>( b );
+    a = avx2_step<Ops, 8, 4>( a );
+    b = avx2_step<Ops, 8, 4>( b );
+    a = avx2_step<Ops, 8, 2>( a );
+    b = avx2_step<Ops, 8, 2>( b );
+    a = avx2_step<Ops, 8, 1>( a );
+    b = avx2_step<Ops, 8, 1>( b );
+
+    b = Ops::permute( b, _mm256_setr_epi32( 7, 6, 5, 4, 3, 2, 1, 0 ) );
+    typename Ops::reg lo = Ops::min( a, b );
+    typename Ops::reg hi = Ops::max( a, b );
+    lo = avx2_step<Ops, 16, 4>( lo );
+    hi = avx2_step<Ops, 16, 4>( hi );
+    lo = avx2_step<Ops, 16, 2>( lo );
+    hi = avx2_step<Ops, 16, 2>( hi );
+    lo = avx2_step<Ops, 16, 1>( lo );
+    hi = avx2_step<Ops, 16, 1>( hi );
+    Ops::store( v, lo );
+    Ops::store( v + 8, hi );
+}
+#endif
+
+#if defined( __SSE2__ ) && !defined( __AVX2__ )
+// Four 32-bit lanes per register; the 16 values live in four registers.
+// SSE2 has no 32-bit integer min/max or blend, so both are built from a
+// compare mask.
+struct sse_i32 {
+    using value = std::int32_t;
+    using reg   = __m128i;
+    static reg load( const value *p ) { return _mm_loadu_si128( reinterpret_cast<const reg *>( p ) ); }
+    static void store( value *p, reg v ) { _mm_storeu_si128( reinterpret_cast<reg *>( p ), v ); }
+    static reg select( reg mask, reg a, reg b ) {
+        return _mm_or_si128( _mm_and_si128( mask, a ), _mm_andnot_si128( mask, b ) );
+    }
+    static reg min( reg a, reg b ) { return select( _mm_cmpgt_epi32( a, b ), b, a ); }
+    static reg max( reg a, reg b ) { return select( _mm_cmpgt_epi32( a, b ), a, b ); }
+    template <int Imm> static reg shuffle( reg v ) { return _mm_shuffle_epi32( v, Imm ); }
+    template <int Mask> static reg blend( reg a, reg b ) {
+        return select( _mm_setr_epi32( Mask & 1 ? -1 : 0, Mask & 2 ? -1 : 0, Mask & 4 ? -1 : 0,
+                           Mask & 8 ? -1 : 0 ),
+            b, a );
+    }
+};
+
+// Flipping the sign bits turns the unsigned order into the signed one.
+struct sse_u32 : sse_i32 {
+    using value = std::uint32_t;
+    static reg load( const value *p ) { return _mm_loadu_si128( reinterpret_cast<const reg *>( p ) ); }
+    static void store( value *p, reg v ) { _mm_storeu_si128( reinterpret_cast<reg *>( p ), v ); }
+    static reg greater( reg a, reg b ) {
+        const reg bias = _mm_set1_epi32( std::numeric_limits<std::int32_t>::min() );
+        return _mm_cmpgt_epi32( _mm_xor_si128( a, bias ), _mm_xor_si128( b, bias ) );
+    }
+    static reg min( reg a, reg b ) { return select( greater( a, b ), b, a ); }
+    static reg max( reg a, reg b ) { return select( greater( a, b ), a, b ); }
+};
+
+struct sse_f32 {
+    using value = float;
+    using reg   = __m128;
+    static reg load( const value *p ) { return _mm_loadu_ps( p ); }
+    static void store( value *p, reg v ) { _mm_storeu_ps( p, v ); }
+    static reg min( reg a, reg b ) { return _mm_min_ps( a, b ); }
+    static reg max( reg a, reg b ) { return _mm_max_ps( a, b ); }
+    template <int Imm> static reg shuffle( reg v ) { return _mm_shuffle_ps( v, v, Imm ); }
+    template <int Mask> static reg blend( reg a, reg b ) {
+        const reg mask = _mm_castsi128_ps( _mm_setr_epi32(
+            Mask & 1 ? -1 : 0, Mask & 2 ? -1 : 0, Mask & 4 ? -1 : 0, Mask & 8 ? -1 : 0 ) );
+        return _mm_or_ps( _mm_and_ps( mask, b ), _mm_andnot_ps( mask, a ) );
+    }
+};
+
+// Compare-exchange within each register against the lane j away.
+template <typename Ops, int K, int J, int Base> typename Ops::reg sse_lanes( typename Ops::reg v ) {
+    typename Ops::reg swapped =
+        Ops::template shuffle<J == 1 ? _MM_SHUFFLE( 2, 3, 0, 1 ) : _MM_SHUFFLE( 1, 0, 3, 2 )>( v );
+    return Ops::template blend<max_lanes( K, J, 4, Base )>(
+        Ops::min( v, swapped ), Ops::max( v, swapped ) );
+}
+
+template <typename Ops, int K, int J> void sse_step( typename Ops::reg *r ) {
+    if constexpr ( J >= 4 ) {
+        // Partners sit in another register and the direction is the same
+        // across a register.
+        for ( int i = 0; i < 4; ++i ) {
+            int l = i ^ ( J / 4 );
+            if ( l > i ) {
+                typename Ops::reg lo = Ops::min( r[i], r[l] );
+                typename Ops::reg hi = Ops::max( r[i], r[l] );
+                bool up              = ( ( i * 4 ) & K ) == 0;
+                r[i]                 = up ? lo : hi;
+                r[l]                 = up ? hi : lo;
+            }
+        }
+    } else {
+        r[0] = sse_lanes<Ops, K, J, 0>( r[0] );
+        r[1] = sse_lanes<Ops, K, J, 4>( r[1] );
+        r[2] = sse_lanes<Ops, K, J, 8>( r[2] );
+        r[3] = sse_lanes<Ops, K, J, 12>( r[3] );
+    }
+}
+
+template <typename Ops> void sse_network( typename Ops::value *v ) {
+    typename Ops::reg r[4] = { Ops::load( v ), Ops::load( v + 4 ), Ops::load( v + 8 ),
+        Ops::load( v + 12 ) };
+    sse_step<Ops, 2, 1>( r );
+    sse_step<Ops, 4, 2>( r );
+    sse_step<Ops, 4, 1>( r );
+    sse_step<Ops, 8, 4>( r );
+    sse_step<Ops, 8, 2>( r );
+    sse_step<Ops, 8, 1>( r );
+    sse_step<Ops, 16, 8>( r );
+    sse_step<Ops, 16, 4>( r );
+    sse_step<Ops, 16, 2>( r );
+    sse_step<Ops, 16, 1>( r );
+    for ( int i = 0; i < 4; ++i ) {
+        Ops::store( v + 4 * i, r[i] );
+    }
+}
+#endif
+
+// Whether network_sort has a SIMD kernel for T. Without one a padded
+// 16-value network loses to insertion sort and Pdq_Sorting.
+template <typename T>
+constexpr bool simd_network =
+#if defined( __AVX2__ ) || defined( __SSE2__ )
+    std::is_same<T, std::int32_t>::value || std::is_same<T, std::uint32_t>::value ||
+    std::is_same<T, float>::value;
+#else
+    false;
+#endif
+
+// Sorts exactly network_size values in place; needs simd_network<T>.
+template <typename T> void network_sort( T *v ) {
+    static_assert( simd_network<T>, "no SIMD sorting network for this type" );
+#if defined( __AVX2__ )
+    if constexpr ( std::is_same<T, std::int32_t>::value ) {
+        avx2_network<avx2_i32>( v );
+    } else if constexpr ( std::is_same<T, std::uint32_t>::value ) {
+        avx2_network<avx2_u32>( v );
+    } else {
+        avx2_network<avx2_f32>( v );
+    }
+#elif defined( __SSE2__ )
+    if constexpr ( std::is_same<T, std::int32_t>::value ) {
+        sse_network<sse_i32>( v );
+    } else if constexpr ( std::is_same<T, std::uint32_t>::value ) {
+        sse_network<sse_u32>( v );
+    } else {
+        sse_network<sse_f32>( v );
+    }
+#endif
+}
+
+} // namespace radix_detail
+
+// Radix sort for integer and floating-point keys. KeyFunc extracts the key
+// from a value (the value itself by default), so records can be sorted by
+// an arithmetic field.
+// - Large inputs of trivially copyable values use LSD radix sort: stable,
+//   one counting pass, then one scatter per byte of key. Bytes on which all
+//   keys agree are skipped, and an extra buffer of n values is needed.
+// - Other inputs use in-place MSD radix sort (American flag sort), which is
+//   not stable.
+// - Buckets of up to 8 values are finished by insertion sort. Blocks of up
+//   to 16 int32, uint32 or float values go through a SIMD sorting network:
+//   AVX2 with -mavx2, else SSE2, which every x86-64 target has. Other small
+//   buckets go to Pdq_Sorting, or std::sort by key with a custom KeyFunc.
+// Keys that are not integers, float or double fall back to Pdq_Sorting at
+// compile time.
+template <typename Iterator, typename KeyFunc = radix_detail::identity>
+class Radix_Sorting : public SortingStrategy<Iterator> {
+public:
+    using value_type = typename std::iterator_traits<Iterator>::value_type;
+    using key_type   = std::decay_t<std::invoke_result_t<const KeyFunc &, const value_type &>>;
+
+    explicit Radix_Sorting( KeyFunc key = KeyFunc() ) : key( std::move( key ) ) {}
+
+    virtual void execute( Iterator first, Iterator last ) override {
+        if constexpr ( !radix_detail::supported_key<key_type> ) {
+            Pdq_Sorting<Iterator>().execute( first, last );
+        } else {
+            std::size_t n = static_cast<std::size_t>( last - first );
+            if ( n < 2 ) return;
+
+            if ( n <= radix_detail::network_size ) {
+                small_sort( first, last );
+                return;
+            }
+            // lsd copies values, so it is not even compiled for move-only
+            // or non-default-constructible records.
+            if constexpr ( std::is_trivially_copyable<value_type>::value ) {
+                if ( n >= lsd_threshold ) {
+                    lsd( first, n );
+                    return;
+                }
+            }
+            msd( first, last, ( sizeof( key_type ) - 1 ) * 8 );
+        }
+    }
+
+private:
+    static constexpr std::size_t lsd_threshold    = std::size_t( 1 ) << 12;
+    static constexpr std::size_t msd_cutoff       = 128; // buckets sorted by comparison
+    static constexpr std::size_t insertion_cutoff = 8; // buckets sorted by insertion
+    static constexpr bool by_value =
+        std::is_same<KeyFunc, radix_detail::identity>::value && std::is_arithmetic<value_type>::value;
+
+    KeyFunc key;
+
+    auto digits( const value_type &value ) const { return radix_detail::to_unsigned( key( value ) ); }
+
+    std::size_t digit( const value_type &value, unsigned shift ) const {
+        return static_cast<std::size_t>( ( digits( value ) >> shift ) & 0xff );
+    }
+
+    bool less( const value_type &a, const value_type &b ) const {
+        if constexpr ( by_value ) {
+            return a < b;
+        } else {
+            return digits( a ) < digits( b );
+        }
+    }
+
+    void insertion_sort( Iterator first, Iterator last ) const {
+        for ( Iterator cur = first; cur != last; ++cur ) {
+            Iterator sift = cur;
+            if ( sift != first && less( *sift, *( sift - 1 ) ) ) {
+                value_type tmp( std::move( *sift ) );
+                do {
+                    *sift = std::move( *( sift - 1 ) );
+                    --sift;
+                } while ( sift != first && less( tmp, *( sift - 1 ) ) );
+                *sift = std::move( tmp );
+            }
+        }
+    }
+
+    void small_sort( Iterator first, Iterator last ) {
+        std::size_t n = static_cast<std::size_t>( last - first );
+        if ( n <= insertion_cutoff ) {
+            insertion_sort( first, last );
+        } else if constexpr ( by_value ) {
+            if constexpr ( radix_detail::simd_network<value_type> ) {
+                if ( n <= radix_detail::network_size ) {
+                    value_type block[radix_detail::network_size];
+                    std::copy( first, last, block );
+                    std::fill( block + n, block + radix_detail::network_size,
+                        std::numeric_limits<value_type>::has_infinity
+                            ? std::numeric_limits<value_type>::infinity()
+                            : std::numeric_limits<value_type>::max() );
+                    radix_detail::network_sort( block );
+                    std::copy( block, block + n, first );
+                    return;
+                }
+            }
+            Pdq_Sorting<Iterator>().execute( first, last );
+        } else {
+            std::sort( first, last, [this]( const value_type &a, const value_type &b ) {
+                return less( a, b );
+            } );
+        }
+    }
+
+    void lsd( Iterator first, std::size_t n ) {
+        constexpr std::size_t passes = sizeof( key_type );
+        std::vector<std::size_t> counts( passes * 256, 0 );
+        for ( Iterator it = first; it != first + static_cast<std::ptrdiff_t>( n ); ++it ) {
+            auto bits = digits( *it );
+            for ( std::size_t p = 0; p < passes; ++p ) {
+                ++counts[p * 256 + ( ( bits >> ( p * 8 ) ) & 0xff )];
+            }
+        }
+
+        // Passes alternate between the input range and one buffer.
+        std::unique_ptr<value_type[]> buffer( new value_type[n] );
+        bool in_buffer = false;
+        for ( std::size_t p = 0; p < passes; ++p ) {
+            std::size_t *count = &counts[p * 256];
+            unsigned shift     = static_cast<unsigned>( p * 8 );
+            if ( count[digit( in_buffer ? buffer[0] : *first, shift )] == n ) {
+                continue;
+            }
+            std::size_t sum = 0;
+            for ( std::size_t d = 0; d < 256; ++d ) {
+                std::size_t c = count[d];
+                count[d]      = sum;
+                sum += c;
+            }
+            if ( in_buffer ) {
+                scatter( buffer.get(), first, n, count, shift );
+            } else {
+                scatter( first, buffer.get(), n, count, shift );
+            }
+            in_buffer = !in_buffer;
+        }
+        if ( in_buffer ) {
+            std::copy( buffer.get(), buffer.get() + n, first );
+        }
+    }
+
+    template <typename Src, typename Dst>
+    void scatter( Src src, Dst dst, std::size_t n, std::size_t *pos, unsigned shift ) const {
+        for ( std::size_t i = 0; i < n; ++i, ++src ) {
+            dst[static_cast<std::ptrdiff_t>( pos[digit( *src, shift )]++ )] = *src;
+        }
+    }
+
+    void msd( Iterator first, Iterator last, unsigned shift ) {
+        for ( ;; ) {
+            std::size_t n = static_cast<std::size_t>( last - first );
+            if ( n <= msd_cutoff ) {
+                small_sort( first, last );
+                return;
+            }
+
+            std::size_t count[256] = {};
+            for ( Iterator it = first; it != last; ++it ) {
+                ++count[digit( *it, shift )];
+            }
+
+            // Every key shares this byte: go straight to the next one.
+            if ( count[digit( *first, shift )] == n ) {
+                if ( shift == 0 ) return;
+                shift -= 8;
+                continue;
+            }
+
+            std::size_t head[256], tail[256];
+            std::size_t sum = 0;
+            for ( std::size_t d = 0; d < 256; ++d ) {
+                head[d] = sum;
+                sum += count[d];
+                tail[d] = sum;
+            }
+
+            // Cycle each misplaced element to the next free slot of its
+            // bucket until the displaced element belongs where we started.
+            for ( std::size_t d = 0; d < 256; ++d ) {
+                while ( head[d] < tail[d] ) {
+                    value_type value( std::move( first[static_cast<std::ptrdiff_t>( head[d] )] ) );
+                    std::size_t target = digit( value, shift );
+                    while ( target != d ) {
+                        std::swap( value, first[static_cast<std::ptrdiff_t>( head[target]++ )] );
+                        target = digit( value, shift );
+                    }
+                    first[static_cast<std::ptrdiff_t>( head[d]++ )] = std::move( value );
+                }
+            }
+
+            if ( shift == 0 ) return;
+            std::size_t begin = 0;
+            for ( std::size_t d = 0; d < 256; ++d ) {
+                if ( count[d] > 1 ) {
+                    msd( first + static_cast<std::ptrdiff_t>( begin ),
+                        first + static_cast<std::ptrdiff_t>( begin + count[d] ), shift - 8 );
+                }
+                begin += count[d];
+            }
+            return;
+        }
+    }
+};
+
+// Parallel samplesort over a WorkStealingPool. Splitters drawn from a
+// sorted sample cut the input into buckets; blocks of the input are
+// classified and scattered into a buffer in parallel, then every bucket is
+// moved back and sorted as its own task. Ranges below cutoff, and single
+// worker pools, are handed to std::sort. Random access iterators only;
+// uses O(n) extra memory.
+template <typename Iterator>
+class Parallel_Sorting : public SortingStrategy<Iterator> {
+public:
+    using value_type = typename std::iterator_traits<Iterator>::value_type;
+
+    explicit Parallel_Sorting( WorkStealingPool &pool = WorkStealingPool::Default(),
+        std::size_t cutoff = std::size_t( 1 ) << 16 )
+        : pool( pool ), cutoff( std::max<std::size_t>( cutoff, 2 ) ) {}
+
+    virtual void execute( Iterator first, Iterator last ) override {
+        sort( first, last );
+    }
+
+private:
+    static constexpr std::size_t oversample  = 32;
+    static constexpr std::size_t max_buckets = 256; // ids fit a byte
+
+    using splitter = std::conditional_t<std::is_copy_constructible<value_type>::value, value_type, Iterator>;
+
+    static const value_type &key( const value_type &value ) { return value; }
+    static const value_type &key( Iterator it ) { return *it; }
+
+    WorkStealingPool &pool;
+    std::size_t cutoff;
+
+    void sort( Iterator first, Iterator last ) {
+        std::size_t n       = static_cast<std::size_t>( last - first );
+        std::size_t threads = pool.size() + 1;
+        if ( n < cutoff || pool.size() < 2 ) {
+            std::sort( first, last );
+            return;
+        }
+
+        std::size_t buckets = std::min( max_buckets, threads * 4 );
+        std::size_t blocks  = threads * 2;
+        std::size_t block   = ( n + blocks - 1 ) / blocks;
+        blocks              = ( n + block - 1 ) / block;
+
+        // Pseudo-random sample, deterministic so runs are reproducible.
+        // It is sorted through iterators and the splitters are copied out
+        // only when value_type allows it; otherwise they stay iterators
+        // into the input, which is not moved until every element has been
+        // classified.
+        std::vector<splitter> splitters;
+        {
+            std::vector<Iterator> sample;
+            sample.reserve( buckets * oversample );
+            std::uint64_t state = 0x9e3779b97f4a7c15ULL ^ n;
+            for ( std::size_t i = 0; i < buckets * oversample; ++i ) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                sample.push_back( first + static_cast<std::ptrdiff_t>( state % n ) );
+            }
+            std::sort( sample.begin(), sample.end(), []( Iterator a, Iterator b ) { return *a < *b; } );
+            for ( std::size_t b = 1; b < buckets; ++b ) {
+                if constexpr ( std::is_copy_constructible<value_type>::value ) {
+                    splitters.push_back( *sample[b * oversample] );
+                } else {
+                    splitters.push_back( sample[b * oversample] );
+                }
+            }
+        }
+
+        // Bucket b holds splitters[b - 1] <= x < splitters[b].
+        std::vector<std::uint8_t> ids( n );
+        std::vector<std::size_t> offsets( blocks * buckets, 0 );
+        ForkJoin( pool, blocks, [&]( std::size_t k ) {
+            std::size_t begin   = k * block;
+            std::size_t end     = std::min( n, begin + block );
+            std::size_t *counts = &offsets[k * buckets];
+            for ( std::size_t i = begin; i < end; ++i ) {
+                auto b = std::upper_bound( splitters.begin(), splitters.end(),
+                             first[static_cast<std::ptrdiff_t>( i )],
+                             []( const value_type &x, const splitter &s ) { return x < key( s ); } ) -
+                         splitters.begin();
+                ids[i] = static_cast<std::uint8_t>( b );
+                ++counts[b];
+            }
+        } );
+
+        // Turn the per-block counts into scatter positions, bucket-major.
+        std::vector<std::size_t> bucket_start( buckets + 1, 0 );
+        std::size_t sum = 0;
+        for ( std::size_t b = 0; b < buckets; ++b ) {
+            bucket_start[b] = sum;
+            for ( std::size_t k = 0; k < blocks; ++k ) {
+                std::size_t count        = offsets[k * buckets + b];
+                offsets[k * buckets + b] = sum;
+                sum += count;
+            }
+        }
+        bucket_start[buckets] = n;
+
+        std::allocator<value_type> alloc;
+        value_type *buffer = alloc.allocate( n );
+        ForkJoin( pool, blocks, [&]( std::size_t k ) {
+            std::size_t begin = k * block;
+            std::size_t end   = std::min( n, begin + block );
+            std::size_t *pos  = &offsets[k * buckets];
+            for ( std::size_t i = begin; i < end; ++i ) {
+                ::new ( static_cast<void *>( buffer + pos[ids[i]]++ ) )
+                    value_type( std::move( first[static_cast<std::ptrdiff_t>( i )] ) );
+            }
+        } );
+
+        ForkJoin( pool, buckets, [&]( std::size_t b ) {
+            std::size_t begin = bucket_start[b];
+            std::size_t end   = bucket_start[b + 1];
+            Iterator out      = first + static_cast<std::ptrdiff_t>( begin );
+            for ( std::size_t i = begin; i < end; ++i ) {
+                out[static_cast<std::ptrdiff_t>( i - begin )] = std::move( buffer[i] );
+                buffer[i].~value_type();
+            }
+            // A bucket swollen by a skewed sample is split again, unless
+            // it is the whole range (say all keys equal).
+            std::size_t size = end - begin;
+            if ( size > 2 * n / buckets + cutoff && size < n ) {
+                sort( out, out + static_cast<std::ptrdiff_t>( size ) );
+            } else {
+                std::sort( out, out + static_cast<std::ptrdiff_t>( size ) );
+            }
+        } );
+        alloc.deallocate( buffer, n );
+    }
+};
+
+enum class SortAlgorithm { Sorted, Reversed, Pdq, Radix, Parallel };
+
+// Picks an algorithm per call from a cheap look at the input: its size,
+// how many adjacent pairs are out of order, how many keys repeat, and at
+// compile time whether the value type can be radix sorted.
+// - Sorted input is left alone and descending input is reversed; both are
+//   confirmed by a full scan, which only runs when no sampled pair
+//   disagrees.
+// - Small, nearly sorted or duplicate-heavy inputs go to Pdq_Sorting,
+//   which is linear or close to it on those patterns.
+// - Large inputs go to Parallel_Sorting when the pool has more than one
+//   worker.
+// - Otherwise, random 32-bit or narrower arithmetic values use
+//   Radix_Sorting; everything else uses Pdq_Sorting. 64-bit keys stay on
+//   Pdq_Sorting, which beats eight memory-bound radix passes.
+template <typename Iterator>
+class Auto_Sorting : public SortingStrategy<Iterator> {
+public:
+    using value_type = typename std::iterator_traits<Iterator>::value_type;
+
+    explicit Auto_Sorting( WorkStealingPool &pool = WorkStealingPool::Default(),
+        std::size_t parallel_cutoff = std::size_t( 1 ) << 20 )
+        : pool( pool ), parallel_cutoff( parallel_cutoff ) {}
+
+    virtual void execute( Iterator first, Iterator last ) override {
+        switch ( select( first, last ) ) {
+        case SortAlgorithm::Sorted:
+            return;
+        case SortAlgorithm::Reversed:
+            std::reverse( first, last );
+            return;
+        case SortAlgorithm::Radix:
+            Radix_Sorting<Iterator>().execute( first, last );
+            return;
+        case SortAlgorithm::Parallel:
+            Parallel_Sorting<Iterator>( pool ).execute( first, last );
+            return;
+        case SortAlgorithm::Pdq:
+            Pdq_Sorting<Iterator>().execute( first, last );
+            return;
+        }
+    }
+
+    SortAlgorithm select( Iterator first, Iterator last ) const {
+        std::size_t n = static_cast<std::size_t>( last - first );
+        if ( n < small_limit ) {
+            return SortAlgorithm::Pdq;
+        }
+
+        // Adjacent pairs spread evenly over the input.
+        std::size_t samples = std::min( n - 1, sample_size );
+        std::size_t step    = ( n - 1 ) / samples;
+        std::size_t ascents = 0, descents = 0;
+        for ( std::size_t i = 0; i < samples; ++i ) {
+            Iterator it = first + static_cast<std::ptrdiff_t>( i * step );
+            if ( *std::next( it ) < *it ) {
+                ++descents;
+            } else if ( *it < *std::next( it ) ) {
+                ++ascents;
+            }
+        }
+        if ( descents == 0 && std::is_sorted( first, last ) ) {
+            return SortAlgorithm::Sorted;
+        }
+        if ( ascents == 0 && std::is_sorted( first, last, []( const value_type &a, const value_type &b ) {
+                 return b < a;
+             } ) ) {
+            return SortAlgorithm::Reversed;
+        }
+        if ( std::min( ascents, descents ) * presorted_ratio < samples ) {
+            return SortAlgorithm::Pdq;
+        }
+
+        // Repeated keys among a strided sample, compared through iterators
+        // so move-only values work too.
+        std::vector<Iterator> picks( samples );
+        for ( std::size_t i = 0; i < samples; ++i ) {
+            picks[i] = first + static_cast<std::ptrdiff_t>( i * ( n / samples ) );
+        }
+        std::sort( picks.begin(), picks.end(), []( Iterator a, Iterator b ) { return *a < *b; } );
+        std::size_t repeats = 0;
+        for ( std::size_t i = 1; i < samples; ++i ) {
+            if ( !( *picks[i - 1] < *picks[i] ) ) {
+                ++repeats;
+            }
+        }
+        if ( repeats * duplicate_ratio > samples ) {
+            return SortAlgorithm::Pdq;
+        }
+
+        if ( n >= parallel_cutoff && pool.size() > 1 ) {
+            return SortAlgorithm::Parallel;
+        }
+        if constexpr ( radix_detail::supported_key<value_type> && sizeof( value_type ) <= 4 ) {
+            if ( n >= radix_limit ) {
+                return SortAlgorithm::Radix;
+            }
+        }
+        return SortAlgorithm::Pdq;
+    }
+
+private:
+    static constexpr std::size_t small_limit     = 64;
+    static constexpr std::size_t sample_size     = 128;
+    static constexpr std::size_t presorted_ratio = 16; // under 1 in 16 pairs out of order
+    static constexpr std::size_t duplicate_ratio = 4;  // over 1 in 4 sampled keys repeat
+    static constexpr std::size_t radix_limit     = std::size_t( 1 ) << 12;
+
+    WorkStealingPool &pool;
+    std::size_t parallel_cutoff;
+};
+
+// Strategy fixed at compile time: held by value and called without
+// virtual dispatch, e.g. SortContext<iterator, Auto_Sorting<iterator>>.
+template <typename Iterator, typename Strategy = void> class SortContext {
+public:
+    explicit SortContext( Strategy strategy = Strategy() ) : strategy( std::move( strategy ) ) {}
+
+    Strategy &getStrategy() { return strategy; }
+
+    void executeStrategy( Iterator first, Iterator last ) {
+        strategy.Strategy::execute( first, last );
+    }
+
+private:
+    Strategy strategy;
+};
+
+// Strategy chosen at run time, for example one loaded from a plugin.
+template <typename Iterator> class SortContext<Iterator, void> {
 public:
     void setStrategy( std::unique_ptr<SortingStrategy<Iterator>> strategy ) {
         this->strategy = std::move( strategy );
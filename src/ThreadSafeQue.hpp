@@ -3,125 +3,201 @@
 #include <mutex>
 #include <atomic>
 #include <memory>
-#include <condition_variable>
-
-template <typename T> class ThreadSafeQue {
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include "QueOps.hpp"
+#include "QueParker.hpp"
+#include "QueSlot.hpp"
+
+// Two-lock queue with a dummy tail node. Payloads live inline in the nodes
+// and popped nodes are recycled through a per-queue free list, so once the
+// queue has grown to its working size push/pop no longer allocate. tail is
+// only written under tail_mutex but read lock-free, so consumers never
+// touch the producers' lock.
+template <typename T> class ThreadSafeQue : public QueOps<ThreadSafeQue<T>, T> {
 private:
+    friend class QueOps<ThreadSafeQue<T>, T>;
+
     struct node {
-        std::shared_ptr<T> data;
-        std::unique_ptr<node> next;
+        alignas( T ) unsigned char storage[sizeof( T )];
+        node *next = nullptr;
+
+        T *value() { return std::launder( reinterpret_cast<T *>( storage ) ); }
     };
 
     std::mutex head_mutex;
-    std::unique_ptr<node> head;
+    std::atomic<node *> head;
     std::mutex tail_mutex;
-    node *tail;
-    std::condition_variable data_cond;
+    std::atomic<node *> tail;
+    // Producers refill spare (guarded by tail_mutex) by taking the whole
+    // recycled stack at once; consumers only ever push onto it, which keeps
+    // the stack free of ABA problems.
+    node *spare = nullptr;
+    std::atomic<node *> recycled{ nullptr };
+    QueParker parker;
     std::atomic<bool> bstop{ false };
 
-    node *get_tail() {
-        std::lock_guard<std::mutex> lock( tail_mutex );
-        return tail;
+    node *get_tail() { return tail.load( std::memory_order_acquire ); }
+
+    // Lock-free hint used while spinning; may be stale.
+    bool ready() {
+        return head.load( std::memory_order_relaxed ) != get_tail();
     }
 
-    std::unique_ptr<node> pop_head() {
-        std::unique_ptr<node> old_head = std::move( head );
-        head                           = std::move( old_head->next );
-        return old_head;
+    bool ready_locked() {
+        std::lock_guard<std::mutex> lock( head_mutex );
+        return head.load( std::memory_order_relaxed ) != get_tail();
     }
 
-    std::unique_lock<std::mutex> wait_for_data() {
-        std::unique_lock<std::mutex> lock( head_mutex );
-        data_cond.wait(
-            lock, [this] { return bstop.load() || head.get() != get_tail(); } );
-        return std::move( lock );
+    node *acquire_node() {
+        if ( !spare ) {
+            spare = recycled.exchange( nullptr, std::memory_order_acquire );
+        }
+        if ( !spare ) {
+            return new node;
+        }
+        node *result = spare;
+        spare        = spare->next;
+        result->next = nullptr;
+        return result;
     }
 
-    std::unique_ptr<node> pop_head( bool &is_stop ) {
-        is_stop = bstop.load();
-        if ( is_stop ) {
-            return nullptr;
+    void recycle( node *first, node *last ) {
+        last->next = recycled.load( std::memory_order_relaxed );
+        while ( !recycled.compare_exchange_weak(
+            last->next, first, std::memory_order_release,
+            std::memory_order_relaxed ) ) {
         }
-        return pop_head();
     }
 
-public:
-    ThreadSafeQue() : head( new node ), tail( head.get() ) {}
+    static void delete_list( node *first ) {
+        while ( first ) {
+            node *next = first->next;
+            delete first;
+            first = next;
+        }
+    }
 
-    ThreadSafeQue( const ThreadSafeQue & )            = delete;
-    ThreadSafeQue &operator=( const ThreadSafeQue & ) = delete;
+    // Caller holds tail_mutex.
+    template <typename... Args> void link_tail( Args &&...args ) {
+        node *new_tail = acquire_node();
+        node *old_tail = tail.load( std::memory_order_relaxed );
+        construct_slot<T>( old_tail->storage, std::forward<Args>( args )... );
+        old_tail->next = new_tail;
+        tail.store( new_tail, std::memory_order_release );
+    }
 
-    void NotifyStop() {
-        bstop.store( true );
-        data_cond.notify_one();
+    // Spins or parks per the wait policy until data may be available.
+    void wait_for_data() {
+        if ( parker.spin( [this] { return bstop.load() || ready(); } ) ) {
+            return;
+        }
+        parker.park( [this] { return bstop.load() || ready_locked(); } );
     }
 
-    std::shared_ptr<T> WaitAndPop() {
-        std::unique_ptr<node> old_head = wait_pop_head();
-        if ( !old_head ) {
+    // Unlinks up to max nodes; the caller holds head_mutex.
+    node *pop_chain( std::size_t max, std::size_t &count ) {
+        count = 0;
+        if ( bstop.load() ) {
             return nullptr;
         }
-        return old_head->data;
+        node *const old_tail = get_tail();
+        node *first          = head.load( std::memory_order_relaxed );
+        node *cur            = first;
+        while ( cur != old_tail && count < max ) {
+            cur = cur->next;
+            ++count;
+        }
+        head.store( cur, std::memory_order_relaxed );
+        return count ? first : nullptr;
     }
 
-    bool WaitAndPop( T &value ) {
-        std::unique_ptr<node> old_head = wait_pop_head( value );
-        return !!old_head;
+    // Hands every payload of a detached chain to func, then recycles it.
+    template <typename Func>
+    void consume_chain( node *first, std::size_t count, Func &&func ) {
+        if ( count == 0 ) {
+            return;
+        }
+        node *cur = first;
+        for ( std::size_t i = 0;; ++i ) {
+            T *value = cur->value();
+            func( std::move( *value ) );
+            value->~T();
+            if ( i + 1 == count ) {
+                break;
+            }
+            cur = cur->next;
+        }
+        recycle( first, cur );
     }
 
-    std::shared_ptr<T> TryPop() {
-        std::unique_ptr<node> old_head = try_pop_head();
-        return old_head ? old_head->data : nullptr;
+    template <typename Func> std::size_t consume_batch( std::size_t max, Func &&func ) {
+        std::size_t count = 0;
+        node *chain;
+        {
+            std::lock_guard<std::mutex> lock( head_mutex );
+            chain = pop_chain( max, count );
+        }
+        consume_chain( chain, count, func );
+        return count;
     }
 
-    bool TryPop( T &value ) {
-        std::unique_ptr<node> old_head = try_pop_head( value );
-        return !!old_head;
+    template <typename Func> bool try_consume( Func &&func ) {
+        return consume_batch( 1, func ) != 0;
     }
 
-    bool empty() {
-        std::lock_guard<std::mutex> lock( head_mutex );
-        return head.get() == get_tail();
-    }
+public:
+    ThreadSafeQue() : head( new node ), tail( head.load() ) {}
 
-    void push( T new_value ) {
-        auto new_data = std::make_shared<T>( std::move( new_value ) );
-        std::unique_ptr<node> new_node( new node );
-        {
-            std::lock_guard<std::mutex> lock( tail_mutex );
-            new_node->data = new_data;
-            tail->next     = std::move( new_node );
-            tail           = tail->next.get();
+    ~ThreadSafeQue() {
+        for ( node *cur = head.load(); cur != tail.load(); cur = cur->next ) {
+            cur->value()->~T();
         }
-        data_cond.notify_one();
+        delete_list( head.load() );
+        delete_list( spare );
+        delete_list( recycled.load() );
     }
 
-private:
-    std::unique_ptr<node> wait_pop_head() {
-        std::unique_lock<std::mutex> lock( wait_for_data() );
-        return pop_head( bstop.load() );
-    }
+    ThreadSafeQue( const ThreadSafeQue & )            = delete;
+    ThreadSafeQue &operator=( const ThreadSafeQue & ) = delete;
+
+    bool empty() { return !ready_locked(); }
 
-    std::unique_ptr<node> wait_pop_head( T &value ) {
-        std::unique_lock<std::mutex> lock( wait_for_data() );
-        std::unique_ptr<node> node = pop_head( bstop.load() );
-        if ( node ) {
-            value = std::move( *node->data );
+    // Constructs the payload directly in the tail node.
+    template <typename... Args> void emplace( Args &&...args ) {
+        {
+            std::lock_guard<std::mutex> lock( tail_mutex );
+            link_tail( std::forward<Args>( args )... );
         }
-        return node;
+        parker.wake( 1 );
     }
 
-    std::unique_ptr<node> try_pop_head() {
-        std::lock_guard<std::mutex> lock( head_mutex );
-        return pop_head( bstop.load() );
+    // The queue is unbounded, so this always succeeds.
+    template <typename... Args> bool TryEmplace( Args &&...args ) {
+        emplace( std::forward<Args>( args )... );
+        return true;
     }
 
-    std::unique_ptr<node> try_pop_head( T &value ) {
-        std::lock_guard<std::mutex> lock( head_mutex );
-        std::unique_ptr<node> node = pop_head( bstop.load() );
-        if ( node ) {
-            value = std::move( *node->data );
+    // Links the whole range under one tail lock and wakes consumers once.
+    // Elements are moved when the range is passed as an rvalue.
+    template <typename Range> std::size_t PushBulk( Range &&range ) {
+        std::size_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock( tail_mutex );
+            for ( auto &&elm : range ) {
+                if constexpr ( std::is_lvalue_reference_v<Range> ) {
+                    link_tail( elm );
+                } else {
+                    link_tail( std::move( elm ) );
+                }
+                ++count;
+            }
+        }
+        if ( count > 0 ) {
+            parker.wake( count );
         }
-        return node;
+        return count;
     }
 };
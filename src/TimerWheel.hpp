@@ -0,0 +1,348 @@
+#pragma once
+
+#include <mutex>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+#include <condition_variable>
+
+// 0 is never a valid id.
+using TimerId = std::uint64_t;
+
+// Hierarchical timing wheel: levels of 256 slots, each level 256 times
+// coarser than the one below. Timers sit in intrusive doubly-linked slot
+// lists over a pooled node array, so Schedule and Cancel are O(1) and a
+// timer moves down a level at most levels - 1 times before it fires.
+// Not thread-safe; TimerService adds the locking and the clock.
+class TimerWheel {
+public:
+    static constexpr unsigned slot_bits = 8;
+    static constexpr unsigned levels    = 4;
+    static constexpr std::uint32_t slot_count = 1u << slot_bits;
+    static constexpr std::uint64_t slot_mask  = slot_count - 1;
+    // Farther deadlines are clamped to this many ticks ahead.
+    static constexpr std::uint64_t max_span = ( std::uint64_t( 1 ) << ( slot_bits * levels ) ) - 1;
+    static constexpr std::uint64_t never    = ~std::uint64_t( 0 );
+
+    struct Task {
+        virtual ~Task() = default;
+        virtual void Run() = 0;
+    };
+
+    TimerWheel() { heads.fill( nil ); }
+
+    TimerWheel( const TimerWheel & )            = delete;
+    TimerWheel &operator=( const TimerWheel & ) = delete;
+
+    std::uint64_t now() const { return current; }
+
+    std::size_t size() const { return live; }
+
+    // Arms task to fire at absolute tick expiry; past ticks fire on the next
+    // Advance. owner only tags the timer for CancelOwner.
+    TimerId Schedule( std::uint64_t expiry, std::unique_ptr<Task> task,
+        const void *owner = nullptr ) {
+        std::uint32_t index = alloc_node();
+        node &n             = nodes[index];
+        // The current tick has already been processed.
+        n.expiry            = expiry > current ? expiry : current + 1;
+        n.task              = std::move( task );
+        n.owner             = owner;
+        link( index );
+        ++live;
+        return ( std::uint64_t( n.gen ) << 32 ) | index;
+    }
+
+    // False if the timer already fired or was cancelled.
+    bool Cancel( TimerId id ) {
+        std::uint32_t index = static_cast<std::uint32_t>( id );
+        if ( index >= nodes.size() || nodes[index].gen != id >> 32 ||
+             nodes[index].slot == nil ) {
+            return false;
+        }
+        unlink( index );
+        free_node( index );
+        return true;
+    }
+
+    // Drops every pending timer tagged with owner; O(pending timers).
+    std::size_t CancelOwner( const void *owner ) {
+        std::size_t count = 0;
+        for ( std::uint32_t i = 0; i < nodes.size(); ++i ) {
+            if ( nodes[i].slot != nil && nodes[i].owner == owner ) {
+                unlink( i );
+                free_node( i );
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    // Moves the wheel to tick target, handing each due task to fire.
+    template <typename Fire> void Advance( std::uint64_t target, Fire &&fire ) {
+        if ( live == 0 ) {
+            current = target > current ? target : current;
+            return;
+        }
+        while ( current < target ) {
+            ++current;
+            // Each level whose lower digits just wrapped to zero is
+            // redistributed, coarsest first, before level 0 expires.
+            unsigned wrapped = 1;
+            while ( wrapped < levels &&
+                    ( current & ( ( std::uint64_t( 1 ) << ( slot_bits * wrapped ) ) - 1 ) ) == 0 ) {
+                ++wrapped;
+            }
+            for ( unsigned level = wrapped - 1; level >= 1; --level ) {
+                cascade( level, ( current >> ( slot_bits * level ) ) & slot_mask );
+            }
+            expire( current & slot_mask, fire );
+            if ( live == 0 ) {
+                current = target;
+            }
+        }
+    }
+
+    // Ticks until the wheel next needs to Advance: the nearest due level-0
+    // slot, or the next cascade point when only coarser levels hold timers.
+    // Returns never when the wheel is empty.
+    std::uint64_t TicksUntilNext() const {
+        if ( live == 0 ) {
+            return never;
+        }
+        for ( std::uint64_t i = 1; i <= slot_count; ++i ) {
+            std::uint64_t tick = current + i;
+            if ( heads[tick & slot_mask] != nil ) {
+                return i;
+            }
+            if ( ( tick & slot_mask ) == 0 ) {
+                return i;
+            }
+        }
+        return slot_count;
+    }
+
+private:
+    static constexpr std::uint32_t nil = ~std::uint32_t( 0 );
+
+    struct node {
+        std::uint64_t expiry = 0;
+        std::unique_ptr<Task> task;
+        const void *owner  = nullptr;
+        std::uint32_t prev = nil, next = nil;
+        std::uint32_t slot = nil; // index into heads, nil when free
+        std::uint32_t gen  = 1;
+    };
+
+    std::vector<node> nodes;
+    std::uint32_t free_head = nil;
+    std::array<std::uint32_t, slot_count * levels> heads;
+    std::uint64_t current = 0;
+    std::size_t live      = 0;
+
+    std::uint32_t alloc_node() {
+        if ( free_head != nil ) {
+            std::uint32_t index = free_head;
+            free_head           = nodes[index].next;
+            return index;
+        }
+        nodes.emplace_back();
+        return static_cast<std::uint32_t>( nodes.size() - 1 );
+    }
+
+    void free_node( std::uint32_t index ) {
+        node &n = nodes[index];
+        n.task.reset();
+        n.owner = nullptr;
+        n.slot  = nil;
+        ++n.gen;
+        n.next    = free_head;
+        free_head = index;
+        --live;
+    }
+
+    std::uint32_t slot_for( std::uint64_t expiry ) const {
+        // Cascaded timers may be due on the current tick, which then goes
+        // into the level-0 slot expired right after the cascade.
+        std::uint64_t delta = expiry - current;
+        if ( delta > max_span ) {
+            delta  = max_span;
+            expiry = current + delta;
+        }
+        unsigned level = 0;
+        while ( level + 1 < levels && delta >= ( std::uint64_t( 1 ) << ( slot_bits * ( level + 1 ) ) ) ) {
+            ++level;
+        }
+        return level * slot_count + ( ( expiry >> ( slot_bits * level ) ) & slot_mask );
+    }
+
+    void link( std::uint32_t index ) {
+        node &n   = nodes[index];
+        n.slot    = slot_for( n.expiry );
+        n.prev    = nil;
+        n.next    = heads[n.slot];
+        if ( n.next != nil ) {
+            nodes[n.next].prev = index;
+        }
+        heads[n.slot] = index;
+    }
+
+    void unlink( std::uint32_t index ) {
+        node &n = nodes[index];
+        if ( n.prev != nil ) {
+            nodes[n.prev].next = n.next;
+        } else {
+            heads[n.slot] = n.next;
+        }
+        if ( n.next != nil ) {
+            nodes[n.next].prev = n.prev;
+        }
+    }
+
+    void cascade( unsigned level, std::uint64_t slot ) {
+        std::uint32_t index = heads[level * slot_count + slot];
+        heads[level * slot_count + slot] = nil;
+        while ( index != nil ) {
+            std::uint32_t next = nodes[index].next;
+            link( index );
+            index = next;
+        }
+    }
+
+    template <typename Fire> void expire( std::uint64_t slot, Fire &fire ) {
+        std::uint32_t index = heads[slot];
+        heads[slot]         = nil;
+        while ( index != nil ) {
+            std::uint32_t next = nodes[index].next;
+            std::unique_ptr<Task> task = std::move( nodes[index].task );
+            free_node( index );
+            fire( std::move( task ) );
+            index = next;
+        }
+    }
+};
+
+// One thread drives a TimerWheel for every actor, so delayed messages need
+// no sleeping thread per timer. The thread only starts with the first
+// timer and sleeps until the next due slot rather than ticking blindly.
+class TimerService {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimerService( Clock::duration tick = std::chrono::milliseconds( 1 ) )
+        : tick_len( tick ), origin( Clock::now() ) {}
+
+    ~TimerService() {
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            bstop = true;
+        }
+        wake_cond.notify_all();
+        if ( thread.joinable() ) {
+            thread.join();
+        }
+    }
+
+    TimerService( const TimerService & )            = delete;
+    TimerService &operator=( const TimerService & ) = delete;
+
+    // Constructing it is cheap (no thread until the first Schedule).
+    static TimerService &Default() {
+        static TimerService service;
+        return service;
+    }
+
+    // func runs on the timer thread no earlier than delay from now.
+    template <typename Func>
+    TimerId Schedule( Clock::duration delay, Func &&func, const void *owner = nullptr ) {
+        struct task : TimerWheel::Task {
+            explicit task( Func &&f ) : func( std::forward<Func>( f ) ) {}
+            void Run() override { func(); }
+            std::decay_t<Func> func;
+        };
+        std::unique_ptr<TimerWheel::Task> job( new task( std::forward<Func>( func ) ) );
+        // Round up so a timer never fires early.
+        std::uint64_t expiry = to_tick( Clock::now() + delay + tick_len - Clock::duration( 1 ) );
+        bool notify;
+        TimerId id;
+        {
+            std::lock_guard<std::mutex> lock( mutex );
+            if ( !thread.joinable() && !bstop ) {
+                thread = std::thread( [this]() { run(); } );
+            }
+            id     = wheel.Schedule( expiry, std::move( job ), owner );
+            notify = expiry < wake_tick;
+        }
+        if ( notify ) {
+            wake_cond.notify_one();
+        }
+        return id;
+    }
+
+    bool Cancel( TimerId id ) {
+        std::lock_guard<std::mutex> lock( mutex );
+        return wheel.Cancel( id );
+    }
+
+    // Cancels owner's timers and waits out any of them already firing, so
+    // the owner may be destroyed once this returns.
+    std::size_t CancelOwner( const void *owner ) {
+        std::lock_guard<std::mutex> fire_lock( fire_mutex );
+        std::lock_guard<std::mutex> lock( mutex );
+        return wheel.CancelOwner( owner );
+    }
+
+private:
+    const Clock::duration tick_len;
+    const Clock::time_point origin;
+    std::mutex fire_mutex; // held while a batch of timers runs
+    std::mutex mutex;      // guards everything below
+    std::condition_variable wake_cond;
+    TimerWheel wheel;
+    std::uint64_t wake_tick = TimerWheel::never;
+    bool bstop              = false;
+    std::thread thread;
+
+    std::uint64_t to_tick( Clock::time_point when ) const {
+        return when <= origin ? 0 : static_cast<std::uint64_t>( ( when - origin ) / tick_len );
+    }
+
+    void run() {
+        std::vector<std::unique_ptr<TimerWheel::Task>> due;
+        for ( ;; ) {
+            std::unique_lock<std::mutex> fire_lock( fire_mutex );
+            std::unique_lock<std::mutex> lock( mutex );
+            if ( bstop ) {
+                return;
+            }
+            wheel.Advance( to_tick( Clock::now() ),
+                [&due]( std::unique_ptr<TimerWheel::Task> &&task ) {
+                    due.push_back( std::move( task ) );
+                } );
+            if ( due.empty() ) {
+                fire_lock.unlock();
+                std::uint64_t wait = wheel.TicksUntilNext();
+                if ( wait == TimerWheel::never ) {
+                    wake_tick = TimerWheel::never;
+                    wake_cond.wait( lock );
+                } else {
+                    wake_tick = wheel.now() + wait;
+                    wake_cond.wait_until( lock, origin + tick_len * wake_tick );
+                }
+                wake_tick = 0;
+                continue;
+            }
+            lock.unlock();
+            for ( auto &task : due ) {
+                task->Run();
+            }
+            due.clear();
+        }
+    }
+};
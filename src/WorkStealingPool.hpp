@@ -0,0 +1,189 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include "QueParker.hpp"
+
+// Fixed-size pool with one task deque per worker. A worker pops its own
+// deque from the back (LIFO, cache friendly) and steals from the front of
+// the others when it runs dry; tasks submitted from a worker stay on that
+// worker's deque, outside submissions are spread round-robin.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(
+        std::size_t thread_count = std::thread::hardware_concurrency() ) {
+        if ( thread_count == 0 ) {
+            thread_count = 1;
+        }
+        for ( std::size_t i = 0; i < thread_count; ++i ) {
+            workers.emplace_back( new worker );
+        }
+        for ( std::size_t i = 0; i < thread_count; ++i ) {
+            threads.emplace_back( [this, i]() { run( i ); } );
+        }
+    }
+
+    ~WorkStealingPool() {
+        bstop.store( true );
+        parker.wake_all();
+        for ( auto &thread : threads ) {
+            thread.join();
+        }
+    }
+
+    WorkStealingPool( const WorkStealingPool & )            = delete;
+    WorkStealingPool &operator=( const WorkStealingPool & ) = delete;
+
+    // Shared pool sized to the core count.
+    static WorkStealingPool &Default() {
+        static WorkStealingPool pool;
+        return pool;
+    }
+
+    std::size_t size() const { return workers.size(); }
+
+    void Submit( Task task ) {
+        std::size_t index = tls_pool == this
+                                ? tls_index
+                                : next.fetch_add( 1, std::memory_order_relaxed ) %
+                                      workers.size();
+        pending.fetch_add( 1 );
+        {
+            std::lock_guard<std::mutex> lock( workers[index]->mutex );
+            workers[index]->tasks.push_back( std::move( task ) );
+        }
+        parker.wake( 1 );
+    }
+
+    // Runs one queued task on the calling thread, so a thread waiting for
+    // pool work to finish can help instead of blocking a worker.
+    bool TryRunOne() {
+        Task task;
+        std::size_t start = tls_pool == this ? tls_index : 0;
+        if ( !pop_local( start, task ) && !steal( start, task ) ) {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+private:
+    struct worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> pending{ 0 };
+    std::atomic<std::size_t> next{ 0 };
+    std::atomic<bool> bstop{ false };
+    QueParker parker;
+
+    static inline thread_local WorkStealingPool *tls_pool = nullptr;
+    static inline thread_local std::size_t tls_index      = 0;
+
+    bool pop_local( std::size_t index, Task &task ) {
+        worker &w = *workers[index];
+        std::lock_guard<std::mutex> lock( w.mutex );
+        if ( w.tasks.empty() ) {
+            return false;
+        }
+        task = std::move( w.tasks.back() );
+        w.tasks.pop_back();
+        pending.fetch_sub( 1 );
+        return true;
+    }
+
+    bool steal( std::size_t self, Task &task ) {
+        for ( std::size_t i = 1; i <= workers.size(); ++i ) {
+            worker &w = *workers[( self + i ) % workers.size()];
+            std::lock_guard<std::mutex> lock( w.mutex );
+            if ( !w.tasks.empty() ) {
+                task = std::move( w.tasks.front() );
+                w.tasks.pop_front();
+                pending.fetch_sub( 1 );
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run( std::size_t index ) {
+        tls_pool  = this;
+        tls_index = index;
+        Task task;
+        for ( ;; ) {
+            if ( pop_local( index, task ) || steal( index, task ) ) {
+                task();
+                task = nullptr;
+                continue;
+            }
+            if ( bstop.load() ) {
+                break;
+            }
+            parker.park( [this] { return bstop.load() || pending.load() > 0; } );
+        }
+    }
+};
+
+// Runs func( 0 .. count - 1 ): index 0 on the calling thread, the rest on
+// the pool. The caller helps with pool work while it waits, so nested calls
+// cannot starve. Every submitted call finishes before ForkJoin returns or
+// throws; the first exception thrown by func is rethrown after that.
+template <typename Func> void ForkJoin( WorkStealingPool &pool, std::size_t count, Func &&func ) {
+    std::atomic<std::size_t> left{ 0 };
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto call = [&func, &error_mutex, &error]( std::size_t i ) {
+        try {
+            func( i );
+        } catch ( ... ) {
+            std::lock_guard<std::mutex> lock( error_mutex );
+            if ( !error ) {
+                error = std::current_exception();
+            }
+        }
+    };
+    auto join = [&pool, &left] {
+        while ( left.load( std::memory_order_acquire ) != 0 ) {
+            if ( !pool.TryRunOne() ) {
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    try {
+        for ( std::size_t i = 1; i < count; ++i ) {
+            left.fetch_add( 1, std::memory_order_relaxed );
+            try {
+                pool.Submit( [&call, &left, i]() {
+                    call( i );
+                    left.fetch_sub( 1, std::memory_order_release );
+                } );
+            } catch ( ... ) {
+                left.fetch_sub( 1, std::memory_order_relaxed );
+                throw;
+            }
+        }
+    } catch ( ... ) {
+        join();
+        throw;
+    }
+    if ( count > 0 ) {
+        call( 0 );
+    }
+    join();
+    if ( error ) {
+        std::rethrow_exception( error );
+    }
+}
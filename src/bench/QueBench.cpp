@@ -0,0 +1,329 @@
+// Mailbox and actor benchmarks. Self-contained; build with e.g.
+//
+//   g++ -std=c++17 -O2 -pthread src/bench/QueBench.cpp -o quebench
+//
+// and run with --help for the options. Every result is printed as one JSON
+// object per line (or as CSV with --csv) so runs can be stored and diffed
+// to catch regressions.
+#include "../ActorSingle.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+std::uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() )
+        .count();
+}
+
+// Message of exactly Size bytes whose first word is the send time.
+template <std::size_t Size> struct Payload {
+    static_assert( Size >= sizeof( std::uint64_t ), "payload too small" );
+
+    std::uint64_t stamp = 0;
+    std::array<unsigned char, Size - sizeof( std::uint64_t )> pad{};
+};
+
+struct Options {
+    std::size_t max_threads = std::max( 2u, std::thread::hardware_concurrency() );
+    std::size_t messages    = 200000;
+    // Caps messages * payload so big payloads cannot exhaust memory when
+    // producers outrun consumers on an unbounded queue.
+    std::size_t max_bytes = std::size_t( 64 ) << 20;
+    bool csv              = false;
+    bool queues           = true;
+    bool chain            = true;
+};
+
+struct Result {
+    std::string bench;
+    std::string queue;
+    std::size_t producers = 0;
+    std::size_t consumers = 0;
+    std::size_t payload   = 0;
+    std::size_t messages  = 0;
+    double seconds        = 0;
+    std::uint64_t p50 = 0, p99 = 0, p999 = 0, max = 0;
+};
+
+void Print( const Options &opt, const Result &r ) {
+    static bool header = false;
+    double rate = r.seconds > 0 ? r.messages / r.seconds : 0;
+    if ( opt.csv ) {
+        if ( !header ) {
+            std::printf( "bench,queue,producers,consumers,payload_bytes,messages,"
+                         "seconds,msgs_per_sec,p50_ns,p99_ns,p999_ns,max_ns\n" );
+            header = true;
+        }
+        std::printf( "%s,%s,%zu,%zu,%zu,%zu,%.6f,%.0f,%llu,%llu,%llu,%llu\n",
+            r.bench.c_str(), r.queue.c_str(), r.producers, r.consumers, r.payload,
+            r.messages, r.seconds, rate, (unsigned long long)r.p50,
+            (unsigned long long)r.p99, (unsigned long long)r.p999,
+            (unsigned long long)r.max );
+    } else {
+        std::printf( "{\"bench\":\"%s\",\"queue\":\"%s\",\"producers\":%zu,"
+                     "\"consumers\":%zu,\"payload_bytes\":%zu,\"messages\":%zu,"
+                     "\"seconds\":%.6f,\"msgs_per_sec\":%.0f,\"p50_ns\":%llu,"
+                     "\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu}\n",
+            r.bench.c_str(), r.queue.c_str(), r.producers, r.consumers, r.payload,
+            r.messages, r.seconds, rate, (unsigned long long)r.p50,
+            (unsigned long long)r.p99, (unsigned long long)r.p999,
+            (unsigned long long)r.max );
+    }
+    std::fflush( stdout );
+}
+
+// Exact percentiles; reorders samples.
+void FillPercentiles( std::vector<std::uint64_t> &samples, Result &r ) {
+    if ( samples.empty() ) {
+        return;
+    }
+    auto at = [&samples]( double q ) {
+        std::size_t k = static_cast<std::size_t>( q * ( samples.size() - 1 ) );
+        std::nth_element( samples.begin(), samples.begin() + k, samples.end() );
+        return samples[k];
+    };
+    r.p50  = at( 0.5 );
+    r.p99  = at( 0.99 );
+    r.p999 = at( 0.999 );
+    r.max  = *std::max_element( samples.begin(), samples.end() );
+}
+
+std::vector<std::size_t> ThreadCounts( std::size_t max ) {
+    std::vector<std::size_t> res;
+    for ( std::size_t n = 1; n < max; n *= 2 ) {
+        res.push_back( n );
+    }
+    res.push_back( max );
+    return res;
+}
+
+// Producers push stamped payloads as fast as they can; consumers record
+// the enqueue-to-dequeue latency of every message.
+template <template <typename> class Que, std::size_t Size>
+Result RunQueue( const char *name, std::size_t producers, std::size_t consumers,
+    std::size_t messages ) {
+    using Msg = Payload<Size>;
+    Que<Msg> que;
+    // Rounded up so every producer sends at least one message; with none
+    // queued the consumers would wait for a total that never arrives.
+    std::size_t per_producer = std::max<std::size_t>( 1, ( messages + producers - 1 ) / producers );
+    std::size_t total        = per_producer * producers;
+    std::atomic<std::size_t> consumed{ 0 };
+    std::atomic<bool> go{ false };
+    std::vector<std::vector<std::uint64_t>> samples( consumers );
+    std::vector<std::thread> threads;
+
+    for ( std::size_t c = 0; c < consumers; ++c ) {
+        samples[c].reserve( total / consumers + 1 );
+        threads.emplace_back( [&, c]() {
+            Msg msg;
+            while ( que.WaitAndPop( msg ) ) {
+                samples[c].push_back( NowNs() - msg.stamp );
+                if ( consumed.fetch_add( 1 ) + 1 == total ) {
+                    que.NotifyStop();
+                }
+            }
+        } );
+    }
+    for ( std::size_t p = 0; p < producers; ++p ) {
+        threads.emplace_back( [&]() {
+            while ( !go.load() ) {
+                std::this_thread::yield();
+            }
+            Msg msg;
+            for ( std::size_t i = 0; i < per_producer; ++i ) {
+                msg.stamp = NowNs();
+                que.push( msg );
+            }
+        } );
+    }
+
+    std::uint64_t start = NowNs();
+    go.store( true );
+    for ( auto &thread : threads ) {
+        thread.join();
+    }
+
+    Result r;
+    r.bench     = "queue";
+    r.queue     = name;
+    r.producers = producers;
+    r.consumers = consumers;
+    r.payload   = Size;
+    r.messages  = total;
+    r.seconds   = ( NowNs() - start ) / 1e9;
+    std::vector<std::uint64_t> all;
+    all.reserve( total );
+    for ( auto &s : samples ) {
+        all.insert( all.end(), s.begin(), s.end() );
+    }
+    FillPercentiles( all, r );
+    return r;
+}
+
+template <std::size_t Size> void QueueSweep( const Options &opt ) {
+    std::size_t messages = std::min( opt.messages, opt.max_bytes / Size );
+    for ( std::size_t producers : ThreadCounts( opt.max_threads ) ) {
+        for ( std::size_t consumers : ThreadCounts( opt.max_threads ) ) {
+            Print( opt, RunQueue<ThreadSafeQue, Size>(
+                            "ThreadSafeQue", producers, consumers, messages ) );
+            Print( opt, RunQueue<RingBufferQue, Size>(
+                            "RingBufferQue", producers, consumers, messages ) );
+        }
+    }
+    Print( opt, RunQueue<SpscQue, Size>( "SpscQue", 1, 1, messages ) );
+}
+
+// Mirror of the ClassA -> ClassB -> ClassC chain with the same mailboxes
+// (ThreadSafeQue, then SpscQue twice), minus the per-message logging,
+// and carrying the time each message entered the chain.
+struct HopMsg {
+    std::uint64_t stamp;
+};
+
+struct ChainSink {
+    std::vector<std::uint64_t> samples;
+    std::atomic<std::size_t> received{ 0 };
+};
+
+ChainSink &Sink() {
+    static ChainSink sink;
+    return sink;
+}
+
+class HopC : public ActorSingle<HopC, HopMsg, SpscQue> {
+    friend class ActorSingle<HopC, HopMsg, SpscQue>;
+
+public:
+    ~HopC() { StopWorker(); }
+
+    void DealMsg( HopMsg msg ) {
+        ChainSink &sink = Sink();
+        sink.samples.push_back( NowNs() - msg.stamp );
+        sink.received.fetch_add( 1, std::memory_order_release );
+    }
+
+private:
+    HopC() : ActorSingle( "HopC" ) { StartThread(); }
+};
+
+class HopB : public ActorSingle<HopB, HopMsg, SpscQue> {
+    friend class ActorSingle<HopB, HopMsg, SpscQue>;
+
+public:
+    ~HopB() { StopWorker(); }
+
+    void DealMsg( HopMsg msg ) { HopC::Inst().PostMsg( msg ); }
+
+private:
+    HopB() : ActorSingle( "HopB" ) {
+        HopC::Inst();
+        StartThread();
+    }
+};
+
+class HopA : public ActorSingle<HopA, HopMsg> {
+    friend class ActorSingle<HopA, HopMsg>;
+
+public:
+    ~HopA() { StopWorker(); }
+
+    void DealMsg( HopMsg msg ) { HopB::Inst().PostMsg( msg ); }
+
+private:
+    HopA() : ActorSingle( "HopA" ) {
+        HopB::Inst();
+        StartThread();
+    }
+};
+
+// paced waits for each message to leave the chain before sending the next,
+// which isolates the wake-up cost of three hops; otherwise the chain is
+// flooded and the latency includes queueing.
+Result RunChain( std::size_t messages, bool paced ) {
+    ChainSink &sink = Sink();
+    HopA &head      = HopA::Inst();
+    std::size_t base = sink.received.load( std::memory_order_acquire );
+    sink.samples.clear();
+    sink.samples.reserve( messages );
+
+    std::uint64_t start = NowNs();
+    for ( std::size_t i = 0; i < messages; ++i ) {
+        head.PostMsg( HopMsg{ NowNs() } );
+        if ( paced ) {
+            while ( sink.received.load( std::memory_order_acquire ) != base + i + 1 ) {
+                CpuRelax();
+            }
+        }
+    }
+    while ( sink.received.load( std::memory_order_acquire ) != base + messages ) {
+        std::this_thread::yield();
+    }
+
+    Result r;
+    r.bench     = paced ? "chain_paced" : "chain_flood";
+    r.queue     = "HopA>HopB>HopC";
+    r.producers = 1;
+    r.consumers = 1;
+    r.payload   = sizeof( HopMsg );
+    r.messages  = messages;
+    r.seconds   = ( NowNs() - start ) / 1e9;
+    FillPercentiles( sink.samples, r );
+    return r;
+}
+
+void Usage( const char *prog ) {
+    std::printf( "usage: %s [--csv] [--threads=N] [--messages=N] [--queues-only]"
+                 " [--chain-only]\n",
+        prog );
+}
+
+} // namespace
+
+int main( int argc, char **argv ) {
+    Options opt;
+    for ( int i = 1; i < argc; ++i ) {
+        const char *arg = argv[i];
+        if ( std::strcmp( arg, "--csv" ) == 0 ) {
+            opt.csv = true;
+        } else if ( std::strncmp( arg, "--threads=", 10 ) == 0 ) {
+            opt.max_threads = std::max<std::size_t>( 1, std::strtoul( arg + 10, nullptr, 10 ) );
+        } else if ( std::strncmp( arg, "--messages=", 11 ) == 0 ) {
+            opt.messages = std::max<std::size_t>( 1, std::strtoul( arg + 11, nullptr, 10 ) );
+        } else if ( std::strcmp( arg, "--queues-only" ) == 0 ) {
+            opt.chain = false;
+        } else if ( std::strcmp( arg, "--chain-only" ) == 0 ) {
+            opt.queues = false;
+        } else {
+            Usage( argv[0] );
+            return std::strcmp( arg, "--help" ) == 0 ? 0 : 1;
+        }
+    }
+
+    // Keep actor diagnostics out of the results.
+    AsyncLogger::Inst().SetFd( STDERR_FILENO );
+
+    if ( opt.queues ) {
+        QueueSweep<8>( opt );
+        QueueSweep<64>( opt );
+        QueueSweep<512>( opt );
+        QueueSweep<4096>( opt );
+    }
+    if ( opt.chain ) {
+        Print( opt, RunChain( std::min<std::size_t>( opt.messages, 20000 ), true ) );
+        Print( opt, RunChain( opt.messages, false ) );
+    }
+    return 0;
+}
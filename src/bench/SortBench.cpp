@@ -0,0 +1,367 @@
+// Sorting strategy benchmarks. Self-contained; build with e.g.
+//
+//   g++ -std=c++17 -O2 -pthread src/bench/SortBench.cpp -o sortbench
+//
+// and run with --help for the options. Every strategy in
+// Strategy_Method.hpp, plus std::sort as the baseline, is timed on every
+// element type, input distribution and size, and each result is printed
+// as one CSV line. Comparisons and moves per element come from a second,
+// untimed run on an instrumented wrapper type; they are left blank for
+// Radix, which reads key bits instead of comparing, and for sizes above
+// --count-limit. The wrapper has no radix key, so Auto's counts are those
+// of the comparison sort it picks for it. Combinations that would take quadratic time
+// are skipped.
+#include "../Strategy_Method.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+std::uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() )
+        .count();
+}
+
+// 64-byte record ordered by its first word.
+struct Wide {
+    std::uint64_t key = 0;
+    std::array<unsigned char, 56> payload{};
+
+    bool operator<( const Wide &other ) const { return key < other.key; }
+    bool operator>( const Wide &other ) const { return other < *this; }
+};
+
+// Counts every comparison and every copy or move of a T. The counters are
+// shared because Parallel_Sorting sorts on pool threads.
+std::atomic<std::uint64_t> compares{ 0 }, moves{ 0 };
+
+template <typename T> struct Counted {
+    T value{};
+
+    Counted() = default;
+    explicit Counted( T value ) : value( std::move( value ) ) {}
+    Counted( const Counted &other ) : value( other.value ) { Moved(); }
+    Counted( Counted &&other ) noexcept : value( std::move( other.value ) ) { Moved(); }
+    Counted &operator=( const Counted &other ) {
+        value = other.value;
+        Moved();
+        return *this;
+    }
+    Counted &operator=( Counted &&other ) noexcept {
+        value = std::move( other.value );
+        Moved();
+        return *this;
+    }
+
+    friend bool operator<( const Counted &a, const Counted &b ) {
+        compares.fetch_add( 1, std::memory_order_relaxed );
+        return a.value < b.value;
+    }
+    friend bool operator>( const Counted &a, const Counted &b ) { return b < a; }
+
+    static void Moved() { moves.fetch_add( 1, std::memory_order_relaxed ); }
+};
+
+enum class Algo { StdSort, Quick, Bubble, Insertion, Pdq, Radix, Parallel, Auto };
+
+struct Strategy {
+    Algo algo;
+    const char *name;
+    bool compares; // orders by operator< alone
+};
+
+const Strategy strategies[] = {
+    { Algo::StdSort, "std::sort", true },
+    { Algo::Quick, "Quick_Sorting", true },
+    { Algo::Bubble, "Bubble_Sorting", true },
+    { Algo::Insertion, "Insertion_Sorting", true },
+    { Algo::Pdq, "Pdq_Sorting", true },
+    { Algo::Radix, "Radix_Sorting", false },
+    { Algo::Parallel, "Parallel_Sorting", true },
+    { Algo::Auto, "Auto_Sorting", true },
+};
+
+template <typename Iterator> void Sort( Algo algo, Iterator first, Iterator last ) {
+    using namespace strategy;
+    switch ( algo ) {
+    case Algo::StdSort:
+        std::sort( first, last );
+        return;
+    case Algo::Quick:
+        SortContext<Iterator, Quick_Sorting<Iterator>>().executeStrategy( first, last );
+        return;
+    case Algo::Bubble:
+        SortContext<Iterator, Bubble_Sorting<Iterator>>().executeStrategy( first, last );
+        return;
+    case Algo::Insertion:
+        SortContext<Iterator, Insertion_Sorting<Iterator>>().executeStrategy( first, last );
+        return;
+    case Algo::Pdq:
+        SortContext<Iterator, Pdq_Sorting<Iterator>>().executeStrategy( first, last );
+        return;
+    case Algo::Radix:
+        SortContext<Iterator, Radix_Sorting<Iterator>>().executeStrategy( first, last );
+        return;
+    case Algo::Parallel:
+        SortContext<Iterator, Parallel_Sorting<Iterator>>().executeStrategy( first, last );
+        return;
+    case Algo::Auto:
+        SortContext<Iterator, Auto_Sorting<Iterator>>().executeStrategy( first, last );
+        return;
+    }
+}
+
+enum class Dist { Random, Sorted, Reversed, OrganPipe, FewUnique, AllEqual };
+
+const std::pair<Dist, const char *> distributions[] = {
+    { Dist::Random, "random" },
+    { Dist::Sorted, "sorted" },
+    { Dist::Reversed, "reversed" },
+    { Dist::OrganPipe, "organ_pipe" },
+    { Dist::FewUnique, "few_unique" },
+    { Dist::AllEqual, "all_equal" },
+};
+
+// Keys below 2^31, so every element type below keeps their order.
+std::vector<std::uint64_t> Keys( Dist dist, std::size_t n ) {
+    std::mt19937_64 rng( 42 );
+    std::vector<std::uint64_t> keys( n );
+    for ( std::size_t i = 0; i < n; ++i ) {
+        switch ( dist ) {
+        case Dist::Random: keys[i] = rng() >> 33; break;
+        case Dist::Sorted: keys[i] = i; break;
+        case Dist::Reversed: keys[i] = n - i; break;
+        case Dist::OrganPipe: keys[i] = i < n / 2 ? i : n - i; break;
+        case Dist::FewUnique: keys[i] = rng() % 16; break;
+        case Dist::AllEqual: keys[i] = 42; break;
+        }
+    }
+    return keys;
+}
+
+template <typename T> T Make( std::uint64_t key );
+
+template <> int Make<int>( std::uint64_t key ) { return static_cast<int>( key ); }
+
+template <> double Make<double>( std::uint64_t key ) { return key * 0.25 - 1e6; }
+
+// Too long for the small string buffer, like most real keys.
+template <> std::string Make<std::string>( std::uint64_t key ) {
+    char text[32];
+    std::snprintf( text, sizeof( text ), "item/%012llu", (unsigned long long)key );
+    return text;
+}
+
+template <> Wide Make<Wide>( std::uint64_t key ) {
+    Wide w;
+    w.key = key;
+    return w;
+}
+
+template <typename T> struct TypeName;
+template <> struct TypeName<int> { static constexpr const char *name = "int"; };
+template <> struct TypeName<double> { static constexpr const char *name = "double"; };
+template <> struct TypeName<std::string> { static constexpr const char *name = "string"; };
+template <> struct TypeName<Wide> { static constexpr const char *name = "struct64"; };
+
+struct Options {
+    std::size_t max_size        = std::size_t( 1 ) << 20;
+    std::size_t quadratic_limit = std::size_t( 1 ) << 14;
+    std::size_t count_limit     = std::size_t( 1 ) << 20;
+    // Caps two copies of the input, so big types cannot exhaust memory.
+    std::size_t max_bytes     = std::size_t( 2 ) << 30;
+    std::uint64_t min_time_ns = 20000000;
+    const char *only_strategy = nullptr;
+    const char *only_type     = nullptr;
+};
+
+// 16, 64, 256, ... then 10^8 as the last step.
+std::vector<std::size_t> Sizes( std::size_t max ) {
+    std::vector<std::size_t> res;
+    for ( std::size_t n = 16; n <= max && n < 100000000; n *= 4 ) {
+        res.push_back( n );
+    }
+    if ( max >= 100000000 ) {
+        res.push_back( 100000000 );
+    }
+    return res;
+}
+
+bool Feasible( const Options &opt, Algo algo, Dist dist, std::size_t n ) {
+    switch ( algo ) {
+    case Algo::Bubble:
+    case Algo::Insertion:
+        return n <= opt.quadratic_limit;
+    case Algo::Quick:
+        // Last-element pivot: quadratic time and linear recursion depth on
+        // anything but random input.
+        return n <= opt.quadratic_limit || dist == Dist::Random;
+    default:
+        return true;
+    }
+}
+
+struct Result {
+    const char *strategy = "";
+    const char *type     = "";
+    const char *dist     = "";
+    std::size_t size     = 0;
+    std::size_t reps     = 0;
+    double ns_per_elem   = 0;
+    bool counted         = false;
+    double compares_per  = 0;
+    double moves_per     = 0;
+};
+
+void Print( const Result &r ) {
+    static bool header = false;
+    if ( !header ) {
+        std::printf( "strategy,type,distribution,size,reps,ns_per_elem,"
+                     "comparisons_per_elem,moves_per_elem\n" );
+        header = true;
+    }
+    std::printf( "%s,%s,%s,%zu,%zu,%.3f,", r.strategy, r.type, r.dist, r.size, r.reps,
+        r.ns_per_elem );
+    if ( r.counted ) {
+        std::printf( "%.3f,%.3f\n", r.compares_per, r.moves_per );
+    } else {
+        std::printf( ",\n" );
+    }
+    std::fflush( stdout );
+}
+
+// Small inputs are sorted in batches of copies under one clock reading, so
+// the timer does not dominate; the result is the median over batches.
+template <typename T>
+Result RunOne( const Options &opt, const Strategy &s, const std::vector<T> &input ) {
+    std::size_t n     = input.size();
+    std::size_t batch = std::max<std::size_t>( 1, 4096 / n );
+    std::vector<T> work( batch * n );
+    std::vector<double> samples;
+    std::uint64_t spent = 0;
+    do {
+        for ( std::size_t b = 0; b < batch; ++b ) {
+            std::copy( input.begin(), input.end(), work.begin() + b * n );
+        }
+        std::uint64_t start = NowNs();
+        for ( std::size_t b = 0; b < batch; ++b ) {
+            Sort( s.algo, work.begin() + b * n, work.begin() + ( b + 1 ) * n );
+        }
+        std::uint64_t took = NowNs() - start;
+        spent += took;
+        samples.push_back( double( took ) / double( batch * n ) );
+        for ( std::size_t b = 0; b < batch; ++b ) {
+            if ( !std::is_sorted( work.begin() + b * n, work.begin() + ( b + 1 ) * n ) ) {
+                std::fprintf( stderr, "%s produced unsorted output\n", s.name );
+                std::exit( 1 );
+            }
+        }
+    } while ( spent < opt.min_time_ns && samples.size() < 1000 );
+
+    Result r;
+    r.strategy = s.name;
+    r.type     = TypeName<T>::name;
+    r.size     = n;
+    r.reps     = samples.size() * batch;
+    std::nth_element( samples.begin(), samples.begin() + samples.size() / 2, samples.end() );
+    r.ns_per_elem = samples[samples.size() / 2];
+
+    if ( s.compares && n <= opt.count_limit ) {
+        std::vector<Counted<T>> counted;
+        counted.reserve( n );
+        for ( const T &value : input ) {
+            counted.emplace_back( value );
+        }
+        compares.store( 0 );
+        moves.store( 0 );
+        Sort( s.algo, counted.begin(), counted.end() );
+        r.counted      = true;
+        r.compares_per = double( compares.load() ) / n;
+        r.moves_per    = double( moves.load() ) / n;
+    }
+    return r;
+}
+
+template <typename T> void TypeSweep( const Options &opt ) {
+    const char *type = TypeName<T>::name;
+    if ( opt.only_type && std::strcmp( opt.only_type, type ) != 0 ) {
+        return;
+    }
+    // Rough footprint of one element, heap text included.
+    std::size_t bytes = sizeof( T ) + ( std::is_same<T, std::string>::value ? 32 : 0 );
+    for ( std::size_t n : Sizes( opt.max_size ) ) {
+        if ( 2 * n * bytes > opt.max_bytes ) {
+            break;
+        }
+        for ( const auto &dist : distributions ) {
+            std::vector<std::uint64_t> keys = Keys( dist.first, n );
+            std::vector<T> input;
+            input.reserve( n );
+            for ( std::uint64_t key : keys ) {
+                input.push_back( Make<T>( key ) );
+            }
+            for ( const Strategy &s : strategies ) {
+                if ( opt.only_strategy && std::strcmp( opt.only_strategy, s.name ) != 0 ) {
+                    continue;
+                }
+                if ( !Feasible( opt, s.algo, dist.first, n ) ) {
+                    continue;
+                }
+                Result r = RunOne( opt, s, input );
+                r.dist   = dist.second;
+                Print( r );
+            }
+        }
+    }
+}
+
+void Usage( const char *prog ) {
+    std::printf( "usage: %s [--max-size=N] [--quadratic-limit=N] [--count-limit=N]"
+                 " [--max-bytes=N] [--min-time-ms=N] [--strategy=NAME]"
+                 " [--type=int|double|string|struct64]\n",
+        prog );
+}
+
+} // namespace
+
+int main( int argc, char **argv ) {
+    Options opt;
+    for ( int i = 1; i < argc; ++i ) {
+        const char *arg = argv[i];
+        if ( std::strncmp( arg, "--max-size=", 11 ) == 0 ) {
+            opt.max_size = std::strtoull( arg + 11, nullptr, 10 );
+        } else if ( std::strncmp( arg, "--quadratic-limit=", 18 ) == 0 ) {
+            opt.quadratic_limit = std::strtoull( arg + 18, nullptr, 10 );
+        } else if ( std::strncmp( arg, "--count-limit=", 14 ) == 0 ) {
+            opt.count_limit = std::strtoull( arg + 14, nullptr, 10 );
+        } else if ( std::strncmp( arg, "--max-bytes=", 12 ) == 0 ) {
+            opt.max_bytes = std::strtoull( arg + 12, nullptr, 10 );
+        } else if ( std::strncmp( arg, "--min-time-ms=", 14 ) == 0 ) {
+            opt.min_time_ns = std::strtoull( arg + 14, nullptr, 10 ) * 1000000;
+        } else if ( std::strncmp( arg, "--strategy=", 11 ) == 0 ) {
+            opt.only_strategy = arg + 11;
+        } else if ( std::strncmp( arg, "--type=", 7 ) == 0 ) {
+            opt.only_type = arg + 7;
+        } else {
+            Usage( argv[0] );
+            return std::strcmp( arg, "--help" ) == 0 ? 0 : 1;
+        }
+    }
+
+    TypeSweep<int>( opt );
+    TypeSweep<double>( opt );
+    TypeSweep<std::string>( opt );
+    TypeSweep<Wide>( opt );
+    return 0;
+}
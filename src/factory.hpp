@@ -1,6 +1,6 @@
 #pragma once
 #include <memory>
-#include <iostream>
+#include "AsyncLog.hpp"
 
 namespace factory {
 // Abstract product
@@ -14,14 +14,14 @@ public:
 class Circle : public Shape {
 public:
     virtual void draw() override {
-        std::cout << "this is a circle" << std::endl;
+        LogInfo( "this is a circle" );
     }
 };
 
 class Square : public Shape {
 public:
     virtual void draw() override {
-        std::cout << "this is a square" << std::endl;
+        LogInfo( "this is a square" );
     }
 };
 
@@ -1,8 +1,8 @@
 #pragma once
 
-#include <iostream>
 #include <memory>
 #include <unordered_set>
+#include "AsyncLog.hpp"
 namespace observer {
 class Observer {
 public:
@@ -41,8 +41,7 @@ private:
 class Display : public Observer {
 public:
     void update( float temperature, float humidity, float pressure ) {
-        std::cout << "Display update: " << temperature << ", " << humidity
-                  << ", " << pressure << std::endl;
+        LogInfo( "Display update: ", temperature, ", ", humidity, ", ", pressure );
     }
 };
 
@@ -1,7 +1,8 @@
 #pragma once
 
 #include <memory>
-#include <iostream>
+#include <string>
+#include "AsyncLog.hpp"
 
 namespace proxy {
 // Define the Subject interface
@@ -14,11 +15,11 @@ public:
 class RealImage : public Image {
 public:
     RealImage( const std::string &filename ) : filename_( filename ) {
-        std::cout << "Loading image: " << filename << std::endl;
+        LogInfo( "Loading image: ", filename );
     }
 
     virtual void display() override {
-        std::cout << "Displaying image: " << filename_ << std::endl;
+        LogInfo( "Displaying image: ", filename_ );
     }
 
 private:
@@ -34,7 +35,7 @@ public:
         // The Proxy checks if the Real Object is created and loads it if
         // necessary
         if ( realImage == nullptr ) {
-            std::cout << "Proxy loaded" << std::endl;
+            LogInfo( "Proxy loaded" );
             realImage = std::make_shared<RealImage>(filename_);
         }
         realImage->display();
@@ -3,7 +3,13 @@
 #include <initializer_list>
 #include <memory>
 #include <queue>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
 #include <iostream>
+#include <algorithm>
 #include <stdexcept>
 
 namespace visitor {
@@ -17,25 +23,25 @@ public:
 
     DataType value_;
     std::shared_ptr<BinaryTreeNode<DataType>> left_, right_;
+    int height_ = 1; // kept by BalancedTreeVisitor; 1 for a leaf
 };
 
-template <typename DataType> class TreeVisitor {
-    using TreeType = BinaryTreeNode<DataType>;
-
+// NodeRef is how a tree backend hands out nodes: shared_ptr for linked
+// BinaryTreeNodes, ArenaTree::Ref for the arena backend.
+template <typename DataType,
+    typename NodeRef = std::shared_ptr<BinaryTreeNode<DataType>>>
+class TreeVisitor {
 public:
     virtual ~TreeVisitor() {}
-    virtual void PreOrderVisit( std::shared_ptr<TreeType> node )   = 0;
-    virtual void InOrderVisit( std::shared_ptr<TreeType> node )    = 0;
-    virtual void PostOrderVisit( std::shared_ptr<TreeType> node )  = 0;
-    virtual void LayerOrderVisit( std::shared_ptr<TreeType> node ) = 0;
-    virtual void insert(
-        std::shared_ptr<TreeType> node, const DataType &value ) = 0;
-    virtual void insert( std::shared_ptr<TreeType> node,
-        const std::initializer_list<DataType> &list = {} )      = 0;
-    virtual std::shared_ptr<TreeType> find(
-        std::shared_ptr<TreeType> node, const DataType &value ) const = 0;
-    virtual void remove(
-        std::shared_ptr<TreeType> node, const DataType &value ) = 0;
+    virtual void PreOrderVisit( NodeRef node )   = 0;
+    virtual void InOrderVisit( NodeRef node )    = 0;
+    virtual void PostOrderVisit( NodeRef node )  = 0;
+    virtual void LayerOrderVisit( NodeRef node ) = 0;
+    virtual void insert( NodeRef node, const DataType &value ) = 0;
+    virtual void insert( NodeRef node,
+        const std::initializer_list<DataType> &list = {} )           = 0;
+    virtual NodeRef find( NodeRef node, const DataType &value ) const = 0;
+    virtual void remove( NodeRef node, const DataType &value )        = 0;
 };
 
 template <typename DataType>
@@ -181,6 +187,464 @@ private:
     }
 };
 
+// AVL variant of ExampleTreeVisitor: insert and remove rebalance on the
+// way back up, so n values are never more than about 1.44 log2 n deep,
+// even when they arrive sorted. Insert, find and remove walk an explicit
+// path instead of recursing. Rotations exchange values between the two
+// nodes involved instead of relinking the top one, so the root the caller
+// holds stays the root; as with ExampleTreeVisitor::remove, a node found
+// earlier may hold another value after a later change.
+template <typename DataType>
+class BalancedTreeVisitor : public ExampleTreeVisitor<DataType> {
+    using TreeType = BinaryTreeNode<DataType>;
+
+public:
+    using ExampleTreeVisitor<DataType>::insert;
+
+    virtual void insert(
+        std::shared_ptr<TreeType> node, const DataType &value ) override {
+        if ( node == nullptr )
+            throw std::invalid_argument( "Node cannot be null" );
+        std::vector<TreeType *> path;
+        TreeType *cur = node.get();
+        for ( ;; ) {
+            path.push_back( cur );
+            auto &child = value < cur->value_ ? cur->left_ : cur->right_;
+            if ( child == nullptr ) {
+                child = std::make_shared<TreeType>( value );
+                break;
+            }
+            cur = child.get();
+        }
+        rebalancePath( path );
+    }
+
+    virtual std::shared_ptr<TreeType> find(
+        std::shared_ptr<TreeType> node, const DataType &value ) const override {
+        if ( node == nullptr )
+            throw std::invalid_argument( "Node cannot be null" );
+        // Follow the links in place; only the result is copied.
+        const std::shared_ptr<TreeType> *link = &node;
+        while ( *link ) {
+            const TreeType &cur = **link;
+            if ( value < cur.value_ ) {
+                link = &cur.left_;
+            } else if ( cur.value_ < value ) {
+                link = &cur.right_;
+            } else {
+                return *link;
+            }
+        }
+        return nullptr;
+    }
+
+    virtual void remove(
+        std::shared_ptr<TreeType> node, const DataType &value ) override {
+        if ( node == nullptr )
+            throw std::invalid_argument( "Node cannot be null" );
+        std::vector<TreeType *> path;
+        std::shared_ptr<TreeType> *link = &node;
+        while ( *link && ( value < ( *link )->value_ || ( *link )->value_ < value ) ) {
+            path.push_back( link->get() );
+            link = value < ( *link )->value_ ? &( *link )->left_ : &( *link )->right_;
+        }
+        if ( *link == nullptr ) return;
+
+        TreeType *target = link->get();
+        if ( target->left_ && target->right_ ) {
+            // Take the successor's value and unlink the successor.
+            path.push_back( target );
+            std::shared_ptr<TreeType> *succ = &target->right_;
+            while ( ( *succ )->left_ ) {
+                path.push_back( succ->get() );
+                succ = &( *succ )->left_;
+            }
+            target->value_                 = std::move( ( *succ )->value_ );
+            std::shared_ptr<TreeType> next = std::move( ( *succ )->right_ );
+            *succ                          = std::move( next );
+        } else if ( path.empty() ) {
+            // Root node case: pull its only child, a leaf, up into it.
+            std::shared_ptr<TreeType> child =
+                target->left_ ? target->left_ : target->right_;
+            if ( child ) {
+                *target = *child;
+            }
+            // Single node tree, do nothing
+            return;
+        } else {
+            std::shared_ptr<TreeType> child =
+                target->left_ ? target->left_ : target->right_;
+            *link = std::move( child );
+        }
+        rebalancePath( path );
+    }
+
+private:
+    static int height( const std::shared_ptr<TreeType> &node ) {
+        return node ? node->height_ : 0;
+    }
+
+    static void updateHeight( TreeType &node ) {
+        node.height_ = 1 + std::max( height( node.left_ ), height( node.right_ ) );
+    }
+
+    // Bottom-up from the changed leaf; stops at the first node whose height
+    // did not change, since nothing above it can be out of balance.
+    static void rebalancePath( const std::vector<TreeType *> &path ) {
+        for ( auto it = path.rbegin(); it != path.rend(); ++it ) {
+            int before = ( *it )->height_;
+            rebalance( **it );
+            if ( ( *it )->height_ == before ) break;
+        }
+    }
+
+    static void rebalance( TreeType &node ) {
+        int balance = height( node.left_ ) - height( node.right_ );
+        if ( balance > 1 ) {
+            if ( height( node.left_->left_ ) < height( node.left_->right_ ) ) {
+                rotateLeft( *node.left_ );
+            }
+            rotateRight( node );
+        } else if ( balance < -1 ) {
+            if ( height( node.right_->right_ ) < height( node.right_->left_ ) ) {
+                rotateRight( *node.right_ );
+            }
+            rotateLeft( node );
+        } else {
+            updateHeight( node );
+        }
+    }
+
+    // top(x: l(a, b), c) becomes top(l: a, x(b, c)), with top kept in
+    // place and the old left child reused for x.
+    static void rotateRight( TreeType &top ) {
+        std::shared_ptr<TreeType> down = std::move( top.left_ );
+        std::swap( top.value_, down->value_ );
+        top.left_    = std::move( down->left_ );
+        down->left_  = std::move( down->right_ );
+        down->right_ = std::move( top.right_ );
+        updateHeight( *down );
+        top.right_ = std::move( down );
+        updateHeight( top );
+    }
+
+    static void rotateLeft( TreeType &top ) {
+        std::shared_ptr<TreeType> down = std::move( top.right_ );
+        std::swap( top.value_, down->value_ );
+        top.right_   = std::move( down->right_ );
+        down->right_ = std::move( down->left_ );
+        down->left_  = std::move( top.left_ );
+        updateHeight( *down );
+        top.left_ = std::move( down );
+        updateHeight( top );
+    }
+};
+
+// Binary search tree stored in one contiguous arena. Children are 32-bit
+// indices rather than pointers, removed nodes go onto a free list threaded
+// through left_, and an insert allocates nothing once the arena has grown.
+// insert sends equal values right, as in ExampleTreeVisitor; a tree built
+// from a sorted range stays balanced, so a run of equal values may also
+// sit left of its middle. Nodes never move between indices, so a Ref
+// stays valid until its node is removed.
+template <typename DataType> class ArenaTree {
+public:
+    using index_type                 = std::uint32_t;
+    static constexpr index_type npos = std::numeric_limits<index_type>::max();
+
+    struct Node {
+        DataType value_;
+        index_type left_, right_;
+    };
+
+    // Node handle for the visitor interface; tests false for no node.
+    class Ref {
+    public:
+        Ref() = default;
+        Ref( ArenaTree *tree, index_type index ) : tree_( tree ), index_( index ) {}
+
+        explicit operator bool() const { return tree_ && index_ != npos; }
+        const Node *operator->() const { return &tree_->nodes_[index_]; }
+        Ref left() const { return Ref( tree_, tree_->nodes_[index_].left_ ); }
+        Ref right() const { return Ref( tree_, tree_->nodes_[index_].right_ ); }
+        ArenaTree *tree() const { return tree_; }
+        index_type index() const { return index_; }
+
+    private:
+        ArenaTree *tree_  = nullptr;
+        index_type index_ = npos;
+    };
+
+    ArenaTree() = default;
+
+    // Balanced tree from a sorted range.
+    template <typename Iterator> ArenaTree( Iterator first, Iterator last ) {
+        assign( first, last );
+    }
+
+    // Replaces the contents with a balanced tree of the sorted range
+    // [first, last) in O(n), reading the range once, front to back.
+    template <typename Iterator> void assign( Iterator first, Iterator last ) {
+        clear();
+        std::size_t n = static_cast<std::size_t>( std::distance( first, last ) );
+        reserve( n );
+        root_ = build( first, n );
+    }
+
+    void reserve( std::size_t n ) { nodes_.reserve( n ); }
+
+    void clear() {
+        nodes_.clear();
+        root_ = free_ = npos;
+        size_ = 0;
+    }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    Ref root() { return Ref( this, root_ ); }
+    Ref ref( index_type index ) { return Ref( this, index ); }
+    const Node &node( index_type index ) const { return nodes_[index]; }
+
+    index_type insert( const DataType &value ) {
+        return root_ == npos ? ( root_ = allocate( value ) ) : insert( root_, value );
+    }
+
+    // Inserts into the subtree rooted at node.
+    index_type insert( index_type node, const DataType &value ) {
+        index_type fresh = allocate( value ); // may move the arena
+        for ( ;; ) {
+            Node &cur         = nodes_[node];
+            index_type &child = value < cur.value_ ? cur.left_ : cur.right_;
+            if ( child == npos ) {
+                child = fresh;
+                return fresh;
+            }
+            node = child;
+        }
+    }
+
+    index_type find( const DataType &value ) const { return find( root_, value ); }
+
+    // Searches the subtree rooted at node; npos if absent.
+    index_type find( index_type node, const DataType &value ) const {
+        while ( node != npos ) {
+            const Node &cur = nodes_[node];
+            if ( value < cur.value_ ) {
+                node = cur.left_;
+            } else if ( cur.value_ < value ) {
+                node = cur.right_;
+            } else {
+                return node;
+            }
+        }
+        return npos;
+    }
+
+    bool remove( const DataType &value ) { return remove( root_, value ); }
+
+    // Removes one node equal to value from the subtree rooted at node. A
+    // node with two children is replaced by relinking its successor, so
+    // no value is copied and other nodes keep their indices.
+    bool remove( index_type node, const DataType &value ) {
+        if ( node == npos ) return false;
+        index_type *link = &link_to( node );
+        while ( *link != npos ) {
+            Node &cur = nodes_[*link];
+            if ( value < cur.value_ ) {
+                link = &cur.left_;
+            } else if ( cur.value_ < value ) {
+                link = &cur.right_;
+            } else {
+                break;
+            }
+        }
+        if ( *link == npos ) return false;
+
+        index_type target = *link;
+        Node &gone        = nodes_[target];
+        if ( gone.left_ != npos && gone.right_ != npos ) {
+            index_type *succ_link = &gone.right_;
+            while ( nodes_[*succ_link].left_ != npos ) {
+                succ_link = &nodes_[*succ_link].left_;
+            }
+            index_type succ = *succ_link;
+            *succ_link      = nodes_[succ].right_;
+            nodes_[succ].left_  = gone.left_;
+            nodes_[succ].right_ = gone.right_;
+            *link               = succ;
+        } else {
+            *link = gone.left_ != npos ? gone.left_ : gone.right_;
+        }
+        gone.left_ = free_;
+        free_      = target;
+        --size_;
+        return true;
+    }
+
+private:
+    std::vector<Node> nodes_;
+    index_type root_ = npos;
+    index_type free_ = npos;
+    std::size_t size_ = 0;
+
+    index_type allocate( const DataType &value ) {
+        index_type index;
+        if ( free_ != npos ) {
+            index          = free_;
+            free_          = nodes_[index].left_;
+            nodes_[index]  = Node{ value, npos, npos };
+        } else {
+            if ( nodes_.size() >= npos ) {
+                throw std::length_error( "ArenaTree is full" );
+            }
+            index = static_cast<index_type>( nodes_.size() );
+            nodes_.push_back( Node{ value, npos, npos } );
+        }
+        ++size_;
+        return index;
+    }
+
+    // In-order: the left half, the middle value, then the right half.
+    template <typename Iterator> index_type build( Iterator &it, std::size_t n ) {
+        if ( n == 0 ) return npos;
+        index_type left  = build( it, n / 2 );
+        index_type self  = allocate( *it );
+        ++it;
+        index_type right    = build( it, n - n / 2 - 1 );
+        nodes_[self].left_  = left;
+        nodes_[self].right_ = right;
+        return self;
+    }
+
+    // The child slot (or root_) that points at node, found by searching
+    // for its value. Equal values may sit on either side of each other, so
+    // the left child of an equal node is kept to search if the right one
+    // does not lead there.
+    index_type &link_to( index_type node ) {
+        const DataType &value = nodes_[node].value_;
+        std::vector<index_type *> pending;
+        index_type *link = &root_;
+        for ( ;; ) {
+            while ( *link != npos && *link != node ) {
+                Node &cur = nodes_[*link];
+                if ( value < cur.value_ ) {
+                    link = &cur.left_;
+                } else if ( cur.value_ < value ) {
+                    link = &cur.right_;
+                } else {
+                    pending.push_back( &cur.left_ );
+                    link = &cur.right_;
+                }
+            }
+            if ( *link == node ) return *link;
+            if ( pending.empty() )
+                throw std::invalid_argument( "Node is not in this tree" );
+            link = pending.back();
+            pending.pop_back();
+        }
+    }
+};
+
+// ExampleTreeVisitor over an ArenaTree. Traversals keep their own stack
+// and queue of indices, so deep trees cannot overflow the call stack.
+template <typename DataType>
+class ArenaTreeVisitor
+    : public TreeVisitor<DataType, typename ArenaTree<DataType>::Ref> {
+    using TreeType  = ArenaTree<DataType>;
+    using Ref       = typename TreeType::Ref;
+    using IndexType = typename TreeType::index_type;
+
+public:
+    virtual void PreOrderVisit( Ref node ) override {
+        if ( !node ) return;
+        std::vector<IndexType> stack{ node.index() };
+        while ( !stack.empty() ) {
+            const auto &cur = node.tree()->node( stack.back() );
+            stack.pop_back();
+            std::cout << cur.value_ << " ";
+            if ( cur.right_ != TreeType::npos ) stack.push_back( cur.right_ );
+            if ( cur.left_ != TreeType::npos ) stack.push_back( cur.left_ );
+        }
+    }
+    virtual void InOrderVisit( Ref node ) override {
+        std::vector<IndexType> stack;
+        IndexType cur = node ? node.index() : TreeType::npos;
+        while ( cur != TreeType::npos || !stack.empty() ) {
+            while ( cur != TreeType::npos ) {
+                stack.push_back( cur );
+                cur = node.tree()->node( cur ).left_;
+            }
+            const auto &top = node.tree()->node( stack.back() );
+            stack.pop_back();
+            std::cout << top.value_ << " ";
+            cur = top.right_;
+        }
+    }
+    virtual void PostOrderVisit( Ref node ) override {
+        if ( !node ) return;
+        // Reversed (node, right, left) pre-order.
+        std::vector<IndexType> stack{ node.index() }, order;
+        while ( !stack.empty() ) {
+            IndexType cur = stack.back();
+            stack.pop_back();
+            order.push_back( cur );
+            const auto &n = node.tree()->node( cur );
+            if ( n.left_ != TreeType::npos ) stack.push_back( n.left_ );
+            if ( n.right_ != TreeType::npos ) stack.push_back( n.right_ );
+        }
+        for ( auto it = order.rbegin(); it != order.rend(); ++it ) {
+            std::cout << node.tree()->node( *it ).value_ << " ";
+        }
+    }
+    virtual void LayerOrderVisit( Ref node ) override {
+        if ( !node ) return;
+
+        std::queue<IndexType> que_;
+        que_.push( node.index() );
+        while ( !que_.empty() ) {
+            const auto &node_ = node.tree()->node( que_.front() );
+            que_.pop();
+            std::cout << node_.value_ << " ";
+            if ( node_.left_ != TreeType::npos ) {
+                que_.push( node_.left_ );
+            }
+
+            if ( node_.right_ != TreeType::npos ) {
+                que_.push( node_.right_ );
+            }
+        }
+    }
+    virtual void insert( Ref node, const DataType &value ) override {
+        if ( !node ) throw std::invalid_argument( "Node cannot be null" );
+        node.tree()->insert( node.index(), value );
+    }
+
+    virtual void insert( Ref node,
+        const std::initializer_list<DataType> &ilist = {} ) override {
+        if ( !node ) throw std::invalid_argument( "Node cannot be null" );
+
+        for ( const auto &elm : ilist ) {
+            insert( node, elm );
+        }
+    }
+
+    template <typename... Args> void emplace( Ref node, Args &&...args ) {
+        if ( !node ) throw std::invalid_argument( "Node cannot be null" );
+        ( insert( node, args ), ... );
+    }
+
+    virtual Ref find( Ref node, const DataType &value ) const override {
+        if ( !node ) throw std::invalid_argument( "Node cannot be null" );
+        return node.tree()->ref( node.tree()->find( node.index(), value ) );
+    }
+
+    virtual void remove( Ref node, const DataType &value ) override {
+        if ( !node ) throw std::invalid_argument( "Node cannot be null" );
+        node.tree()->remove( node.index(), value );
+    }
+};
+
 inline void test_func() {
     std::shared_ptr<BinaryTreeNode<int>> tree =
         std::make_shared<BinaryTreeNode<int>>( 15 );
@@ -192,5 +656,13 @@ inline void test_func() {
     std::cout << std::endl;
     visitor.remove( tree, 10 );
     visitor.LayerOrderVisit( tree );
+    std::cout << std::endl;
+
+    // The same sorted run stays about log2 n deep when balanced.
+    std::shared_ptr<BinaryTreeNode<int>> balanced =
+        std::make_shared<BinaryTreeNode<int>>( 15 );
+    BalancedTreeVisitor<int> avl;
+    avl.emplace( balanced, 10, 20, 30, 40, 50, 60, 70, 80 );
+    avl.LayerOrderVisit( balanced );
 }
 }; // namespace visitor